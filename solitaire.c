@@ -9,6 +9,18 @@
 
 #define STB_KEYPRESS_IMPLEMENTATION
 #include "stb_keypress.h"
+#define STB_RECORD_IMPLEMENTATION
+#include "stb_record.h"
+#define STB_SOLITAIRE_IMPLEMENTATION
+#include "stb_solitaire.h"
+#define STB_METRICS_IMPLEMENTATION
+#include "stb_metrics.h"
+#define STB_RACE_IMPLEMENTATION
+#include "stb_race.h"
+#define STB_SOLVER_IMPLEMENTATION
+#include "stb_solver.h"
+#define STB_ANALYST_IMPLEMENTATION
+#include "stb_analyst.h"
 
 #define LEN(array)             (sizeof(array) / sizeof((array)[0]))
 #define MOD(dividend, divisor) ((((int)(dividend)) % ((int)(divisor)) + ((int)(divisor))) % ((int)(divisor)))
@@ -20,15 +32,13 @@
 #define OFFSET_VERTICAL   (CARD_HEIGHT / 3 + 1)
 #define OFFSET_HORIZONTAL (2 * CARD_WIDTH / 3)
 #define BOARD_HEIGHT      (CARD_HEIGHT + GAP_VERTICAL + CARD_HEIGHT * 6)
-#define BOARD_WIDTH       (CARD_WIDTH * 7 + GAP_HORIZONTAL * 6 )
-#define BOARD_SIZE        (BOARD_HEIGHT * BOARD_WIDTH)
-#define BOARD_POS(x, y)   ((y) * BOARD_WIDTH + (x))
-
-#define DECK_SIZE              52
-#define LAST_NTH_CARD_OF(x, y) ((x).cards[(x).size-(y)])
-#define LAST_CARD_OF(x)        LAST_NTH_CARD_OF(x, 1)
-#define SUITE_OF(x)            ((x).number / 13)
-#define RANK_OF(x)             ((x).number % 13)
+#define BOARD_MAX_HEIGHT  (CARD_HEIGHT + GAP_VERTICAL + OFFSET_VERTICAL * (MAX_CARDS - 1) + CARD_HEIGHT)
+#define BOARD_MAX_WIDTH   (CARD_WIDTH * MAX_COLUMNS + GAP_HORIZONTAL * (MAX_COLUMNS - 1))
+#define BOARD_WIDTH(game) (CARD_WIDTH * (game)->variant->columns + GAP_HORIZONTAL * ((game)->variant->columns - 1))
+#define BOARD_SIZE        (BOARD_MAX_HEIGHT * BOARD_MAX_WIDTH)
+#define FRAME_CAPACITY    (BOARD_SIZE * 24 + 1024)
+#define ANALYST_MEMORY    (16 << 20)
+#define ANALYST_NODES     200000
 
 #define TERM_RESET          (0 << 24)
 #define TERM_BOLD           (1 << 24)
@@ -60,491 +70,465 @@
 #define TERM_FG_WHITE       (37 << 8)
 #define TERM_FG_DEFAULT     (39 << 8)
 
+#define TERM_BLANK          (TERM_RESET | TERM_BG_DEFAULT | TERM_FG_DEFAULT | ' ')
+
 const char suite_symbols[] = { 'H', 'D', 'S', 'C' };
 const char rank_symbols[]  = { 'A', '2', '3', '4', '5', '6', '7', '8', '9', 'T', 'J', 'Q', 'K' }; 
 
-typedef struct Card {
-    int  number;
-    bool hidden;
-    bool selected;
-    bool dragged;
-} Card;
-
-typedef struct Pile {
-    Card   cards[DECK_SIZE];
-    size_t size;
-} Pile;
-
 typedef struct Selection {
     int pile_idx;
     int card_idx;
 } Selection;
 
-void PrintPixel(uint32_t pixel_data)
+/* Every move played so far, undo replays all but the last one from the deal. */
+typedef struct History {
+    Move   *moves;
+    size_t  count;
+    size_t  capacity;
+} History;
+
+size_t PrintPixel(FILE *screen, uint32_t pixel_data)
 {
     uint8_t term        = (pixel_data >> 24) & 0xff;
     uint8_t color_bg    = (pixel_data >> 16) & 0xff;
     uint8_t color_fg    = (pixel_data >>  8) & 0xff;
     char symbol         = pixel_data & 0xff;
-    printf("\x1B[%d;%d;%dm%c\x1B[0m", term, color_bg, color_fg, symbol);
+    return fprintf(screen, "\x1B[%d;%d;%dm%c\x1B[0m", term, color_bg, color_fg, symbol);
 }
 
-void PrintBuffer(uint32_t *buffer)
+/* The pixel at `column` and `row` of a card, both counted from its top left corner. */
+uint32_t CardPixel(Card card, bool selected, bool dragged, int column, int row)
 {
-    for (size_t row=0; row<BOARD_HEIGHT; ++row) {
-        for (size_t col=0; col<BOARD_WIDTH; ++col) {
-            PrintPixel(buffer[BOARD_POS(col, row)]);
-        }
-        printf("\n");
+    if (column == 0 || row == 0 || column == CARD_WIDTH - 1 || row == CARD_HEIGHT - 1) {
+        return TERM_FG_DEFAULT | (selected ? TERM_BG_YELLOW : dragged ? TERM_BG_GREEN : TERM_BG_BLUE) | ' ';
     }
-}
-
-void DrawRectangle(uint32_t *buffer, int x, int y, size_t w, size_t h, uint32_t value)
-{
-    if (x < 0 || y < 0 || x+w > BOARD_WIDTH || y+h > BOARD_HEIGHT) {
-        fprintf(stderr, "%s:%d: Cannot draw rectangle due to out of bounds", __FILE__, __LINE__);
-        return;
+    if (card.hidden) {
+        return TERM_FG_DEFAULT | TERM_BG_MAGENTA | ' ';
     }
-    for (size_t i=0; i<w; ++i) {
-        buffer[BOARD_POS(x+i, y    )] = value;
-        buffer[BOARD_POS(x+i, y+h-1)] = value;
+    uint32_t bg_color = SUITE_OF(card) < 2 ? TERM_BG_RED : TERM_BG_BLACK;
+    bool     top_left = column == 1 && row == 1, bottom_right = column == CARD_WIDTH - 2 && row == CARD_HEIGHT - 2;
+    bool     top_right = column == CARD_WIDTH - 2 && row == 1, bottom_left = column == 1 && row == CARD_HEIGHT - 2;
+    if (top_left || bottom_right) {
+        return TERM_BOLD | TERM_FG_WHITE | bg_color | rank_symbols[RANK_OF(card)];
     }
-    for (size_t i=0; i<h; ++i) {
-        buffer[BOARD_POS(x    , y+i)] = value;
-        buffer[BOARD_POS(x+w-1, y+i)] = value;
+    if (top_right || bottom_left) {
+        return TERM_BOLD | TERM_FG_WHITE | bg_color | suite_symbols[SUITE_OF(card)];
     }
-    buffer[BOARD_POS(x    , y    )] = value;
-    buffer[BOARD_POS(x    , y+h-1)] = value;
-    buffer[BOARD_POS(x+w-1, y    )] = value;
-    buffer[BOARD_POS(x+w-1, y+h-1)] = value;
+    return TERM_FG_DEFAULT | bg_color | ' ';
 }
 
-void FillRectangle(uint32_t *buffer, int x, int y, size_t w, size_t h, uint32_t value)
+bool IsSelected(Selection selection, int pile_idx, int card_idx)
 {
-    if (x < 0 || y < 0 || x+w > BOARD_WIDTH || y+h > BOARD_HEIGHT) {
-        fprintf(stderr, "%s:%d: Cannot draw rectangle due to out of bounds", __FILE__, __LINE__);
-        return;
-    }
-    for (int i=1; i<h-1; ++i) {
-        for (int j=1; j<w-1; ++j) {
-            buffer[BOARD_POS(x+j, y+i)] = value;
+    return selection.pile_idx == pile_idx && selection.card_idx == card_idx;
+}
+
+size_t BoardHeight(Game *game)
+{
+    size_t height = BOARD_HEIGHT;
+    for (int i=0; i<game->variant->columns; ++i) {
+        size_t size = game->piles[COLUMN_ID(game, i)].size;
+        if (size > 0 && CARD_HEIGHT + GAP_VERTICAL + OFFSET_VERTICAL * (size - 1) + CARD_HEIGHT > height) {
+            height = CARD_HEIGHT + GAP_VERTICAL + OFFSET_VERTICAL * (size - 1) + CARD_HEIGHT;
         }
     }
+    return height;
 }
 
-void RenderCard(uint32_t *buffer, int x, int y, int card_number, bool hidden, bool selected, bool dragged)
+/* Where a pile crosses one board row. `x` is the left of the pile's first card on the row and `card_row` the row of
+ * the card that shows. `card_idx` is that card, -1 for the outline of an empty pile, and `fan` the number of cards
+ * spread to the left of it, more than one only for the poll. */
+typedef struct PileRow {
+    int pile_idx;
+    int x;
+    int card_idx;
+    int card_row;
+    int fan;
+} PileRow;
+
+/* Fills `rows` with the piles crossing board row `y` in drawing order, returns how many there are. */
+size_t PileRows(Game *game, int y, PileRow rows[])
 {
-    if (card_number > 52 || card_number < 0) {
-        fprintf(stderr, "%s:%d: Card number should between 0 and 51 (inclusive), but passed %d", __FILE__, __LINE__, card_number);
-        return;
-    }
-    int suite = card_number / 13;
-    int rank  = card_number % 13;
-    
-    if (selected) {
-        DrawRectangle(buffer, x, y, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_YELLOW | ' ');
-    } else if (dragged) {
-        DrawRectangle(buffer, x, y, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_GREEN | ' ');
-    } else {
-        DrawRectangle(buffer, x, y, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_BLUE | ' ');
+    size_t count = 0;
+    for (int i=0; i<game->pile_count; ++i) {
+        PileInfo info = game->infos[i];
+        int      size = PileSize(game, i);
+        int      top  = info.role == ROLE_COLUMN ? CARD_HEIGHT + GAP_VERTICAL : 0;
+        PileRow  row  = { .pile_idx = i, .x = (CARD_WIDTH + GAP_HORIZONTAL) * info.slot, .card_idx = size - 1, .card_row = y - top, .fan = 1 };
+        if (info.role == ROLE_POLL && size > 0) {  /* Poll Shows up to Three Cards */
+            row.fan      = size > 3 ? 3 : size;
+            row.card_idx = size - row.fan;
+        } else if (info.role == ROLE_COLUMN && size > 0 && row.card_row >= 0) {  /* Topmost Card Reaching the Row */
+            row.card_idx = row.card_row / OFFSET_VERTICAL < size ? row.card_row / OFFSET_VERTICAL : size - 1;
+            row.card_row = row.card_row - OFFSET_VERTICAL * row.card_idx;
+        }
+        if (row.card_row < 0 || row.card_row >= CARD_HEIGHT || (info.role == ROLE_POLL && size == 0)) {
+            continue;
+        }
+        rows[count++] = row;
     }
+    return count;
+}
 
-    if (hidden) {
-        FillRectangle(buffer, x, y, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_MAGENTA | ' ');
-    } else {
-        uint32_t bg_color = suite < 2 ? TERM_BG_RED : TERM_BG_BLACK;
-        FillRectangle(buffer, x, y, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | bg_color | ' ');
-        buffer[BOARD_POS(x+1,            y+1)]             = TERM_BOLD | TERM_FG_WHITE | bg_color | rank_symbols[rank];
-        buffer[BOARD_POS(x+CARD_WIDTH-2, y+1)]             = TERM_BOLD | TERM_FG_WHITE | bg_color | suite_symbols[suite];
-        buffer[BOARD_POS(x+CARD_WIDTH-2, y+CARD_HEIGHT-2)] = TERM_BOLD | TERM_FG_WHITE | bg_color | rank_symbols[rank];
-        buffer[BOARD_POS(x+1,            y+CARD_HEIGHT-2)] = TERM_BOLD | TERM_FG_WHITE | bg_color | suite_symbols[suite];
+/* Builds board row `y` from the pile geometry and prints it, without a framebuffer. Each pile crossing the row
+ * shows one card there: the topmost column card whose rows include `y`, or for the poll, whose cards fan out to the
+ * left, the topmost card at each position. Cards covered by other cards are never looked at. */
+size_t PrintRow(FILE *screen, Game *game, int y, Selection selected, Selection dragged)
+{
+    PileRow rows[MAX_PILES];
+    size_t  count   = PileRows(game, y, rows);
+    size_t  written = 0;
+    for (int x=0; x<BOARD_WIDTH(game); ++x) {
+        uint32_t pixel = TERM_BLANK;
+        for (size_t k=count; k-- > 0; ) {  /* Piles Drawn Later Cover Earlier Ones */
+            PileRow row = rows[k];
+            if (x < row.x - OFFSET_HORIZONTAL * (row.fan - 1) || x >= row.x + CARD_WIDTH) {
+                continue;
+            }
+            int fanned = (row.x - x + CARD_WIDTH - 1) / OFFSET_HORIZONTAL;
+            int shown  = fanned < row.fan - 1 ? fanned : row.fan - 1;
+            int column = x - row.x + OFFSET_HORIZONTAL * shown;
+            if (row.card_idx >= 0) {
+                int  card_idx = row.card_idx + shown;
+                Card card     = PileCard(game, row.pile_idx, card_idx);
+                bool on_deck  = game->infos[row.pile_idx].role == ROLE_DECK;
+                card.hidden   = card.hidden || on_deck;
+                pixel = CardPixel(card, on_deck ? selected.pile_idx == row.pile_idx : IsSelected(selected, row.pile_idx, card_idx),
+                    !on_deck && IsSelected(dragged, row.pile_idx, card_idx), column, row.card_row);
+            } else if (column == 0 || row.card_row == 0 || column == CARD_WIDTH - 1 || row.card_row == CARD_HEIGHT - 1) {
+                pixel = TERM_FG_DEFAULT | (selected.pile_idx == row.pile_idx ? TERM_BG_YELLOW : TERM_BG_CYAN) | ' ';
+            } else {  /* Outlines Are Open Inside */
+                continue;
+            }
+            break;
+        }
+        written += PrintPixel(screen, pixel);
     }
+    written += fprintf(screen, "\n");
+    return written;
 }
 
-void RenderPiles(uint32_t *buffer, Pile *deck, Pile *poll, Pile *columns, Pile *foundations, Pile *piles[], int selected_pile_idx)
+size_t PrintBoard(FILE *screen, Game *game, size_t height, Selection selected, Selection dragged)
 {
-    /* Draw Deck Pile */
-    if (piles[selected_pile_idx] == deck) {
-        DrawRectangle(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 6, 0, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_YELLOW | ' ');
-    } else {
-        DrawRectangle(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 6, 0, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_CYAN | ' ');
-    }
-    if (deck->size >= 1) {
-        RenderCard(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 6, 0,
-                    LAST_CARD_OF(*deck).number, LAST_CARD_OF(*deck).hidden, LAST_CARD_OF(*deck).selected, LAST_CARD_OF(*deck).dragged);
+    size_t written = 0;
+    for (size_t row=0; row<height; ++row) {
+        written += PrintRow(screen, game, row, selected, dragged);
     }
-    /* Draw Poll Pile */
-    if (poll->size == 1) {
-        RenderCard(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 0, 0, 
-                    LAST_CARD_OF(*poll).number, LAST_CARD_OF(*poll).hidden, LAST_CARD_OF(*poll).selected, LAST_CARD_OF(*poll).dragged);
-    } else if (poll->size == 2) {
-        RenderCard(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 0, 0, 
-                    LAST_NTH_CARD_OF(*poll, 2).number, LAST_NTH_CARD_OF(*poll, 2).hidden, LAST_NTH_CARD_OF(*poll, 2).selected, LAST_NTH_CARD_OF(*poll, 2).dragged);
-        RenderCard(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 1, 0, 
-                    LAST_CARD_OF(*poll).number, LAST_CARD_OF(*poll).hidden, LAST_CARD_OF(*poll).selected, LAST_CARD_OF(*poll).dragged);
-    } else if (poll->size >= 3) {
-        RenderCard(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 0, 0, 
-                    LAST_NTH_CARD_OF(*poll, 3).number, LAST_NTH_CARD_OF(*poll, 3).hidden, LAST_NTH_CARD_OF(*poll, 3).selected, LAST_NTH_CARD_OF(*poll, 3).dragged);
-        RenderCard(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 1, 0, 
-                    LAST_NTH_CARD_OF(*poll, 2).number, LAST_NTH_CARD_OF(*poll, 2).hidden, LAST_NTH_CARD_OF(*poll, 2).selected, LAST_NTH_CARD_OF(*poll, 2).dragged);
-        RenderCard(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 2, 0, 
-                    LAST_CARD_OF(*poll).number, LAST_CARD_OF(*poll).hidden, LAST_CARD_OF(*poll).selected, LAST_CARD_OF(*poll).dragged);
-    }
-    /* Draw Column Piles */
-    for (int i=0; i<7; ++i) {
-        if (piles[selected_pile_idx] == &columns[i]) {
-            DrawRectangle(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * i, CARD_HEIGHT + GAP_VERTICAL, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_YELLOW | ' ');
-        } else {
-            DrawRectangle(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * i, CARD_HEIGHT + GAP_VERTICAL, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_CYAN | ' ');
-        }
-    }
-    for (size_t i=0; i<7; ++i) {
-        Pile column = columns[i];
-        for (size_t j=0; j<column.size; ++j) {
-            Card card = column.cards[j];
-            RenderCard(buffer,
-                (CARD_WIDTH  + GAP_HORIZONTAL) * i,
-                (OFFSET_VERTICAL * j) + (CARD_HEIGHT + GAP_VERTICAL),
-                card.number, card.hidden, card.selected, card.dragged); 
-        }
+    return written;
+}
+
+/* Applies a checked move and passes it on to the history, the metrics, the other racers and the game log. */
+void PlayMove(Game *game, Move move, int *turn_count, History *history, Metrics *metrics, Race *race, FILE *log)
+{
+    if (history->count == history->capacity) {
+        history->capacity = history->capacity > 0 ? 2 * history->capacity : 256;
+        history->moves    = realloc(history->moves, history->capacity * sizeof(Move));
     }
-    /* Draw Foundation Piles */
-    for (int i=0; i<4; ++i) {
-        if (piles[selected_pile_idx] == &foundations[i]) {
-            DrawRectangle(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * i, 0, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_YELLOW | ' ');
-        } else {
-            DrawRectangle(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * i, 0, CARD_WIDTH, CARD_HEIGHT, TERM_FG_DEFAULT | TERM_BG_CYAN | ' ');
-        }
+    if (history->moves != NULL) {
+        history->moves[history->count++] = move;
     }
-    for (size_t i=0; i<4; ++i) {
-        Pile foundation = foundations[i];
-        if (foundation.size >= 1) {
-            RenderCard(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * i, 0, 
-                        LAST_CARD_OF(foundation).number, LAST_CARD_OF(foundation).hidden, LAST_CARD_OF(foundation).selected, LAST_CARD_OF(foundation).dragged);
-        }
+    MetricsAdd(metrics, METRIC_MOVES, 1);
+    if (game->variant->apply_move(game, move)) {
+        (*turn_count)++;
     }
+    RaceSendMove(race, move);
+    GameLogMove(log, move);
 }
 
-bool IsGameFinished(Pile *foundations)
+/* Deals the game again and replays the history without its last move. Returns the new turn count. */
+int UndoMove(Game *game, unsigned int seed, History *history)
 {
-    int filled = 0;
-    for (size_t i=0; i<4; ++i) {
-        if (foundations[i].size == 13) {
-            filled++;
-        }
+    GameInit(game, game->variant, seed, game->stock.draw_count);
+    int turn_count = 0;
+    history->count--;
+    for (size_t i=0; i<history->count; ++i) {
+        turn_count += game->variant->apply_move(game, history->moves[i]);
     }
-    return filled == 4;
+    return turn_count;
 }
 
-int GetIndexOfPile(Pile *piles[], size_t pile_count, Pile *pile)
+int main(int argc, char *argv[])
 {
-    for (size_t i=0; i<pile_count; ++i) {
-        if (pile == piles[i]) {
-            return i;
+    size_t         draw_count  = 3;
+    bool           skip_dead   = false;
+    char          *record_path = NULL;
+    char          *race_path   = NULL;
+    char          *log_path    = NULL;
+    const Variant *variant     = variants[0];
+    for (int i=1; i<argc; ++i) {
+        if (strncmp(argv[i], "--record=", 9) == 0) {
+            record_path = argv[i] + 9;
+        } else if (strncmp(argv[i], "--race=", 7) == 0) {
+            race_path = argv[i] + 7;
+        } else if (strncmp(argv[i], "--log=", 6) == 0) {
+            log_path = argv[i] + 6;
+        } else if (strncmp(argv[i], "--game=", 7) == 0 && FindVariant(argv[i] + 7) != NULL) {
+            variant = FindVariant(argv[i] + 7);
+        } else if (strcmp(argv[i], "--skip-dead") == 0) {
+            skip_dead = true;
+        } else if (sscanf(argv[i], "--draw=%zu", &draw_count) != 1 || (draw_count != 1 && draw_count != 3)) {
+            fprintf(stderr, "Usage: %s [--game=klondike|freecell|spider] [--draw=1|--draw=3] [--skip-dead] [--record=FILE] [--race=SOCKET] [--log=FILE]\n", argv[0]);
+            return 1;
         }
     }
-    return -1;
-}
 
-int main()
-{
-    uint32_t *buffer = (uint32_t*) malloc(BOARD_SIZE * sizeof(uint32_t));
-    if (buffer == NULL) {
-        fprintf(stderr, "%s:%d: Couldn't allocate buffer memory", __FILE__, __LINE__);
-        return 1;
+    Race *race = NULL;
+    if (race_path != NULL) {
+        printf("Waiting for the other players...\n");
+        race = RaceJoin(race_path, variant, draw_count);
+        if (race == NULL) {
+            return 1;
+        }
+        variant    = race->variant;
+        draw_count = race->draw_count;
+    }
+
+    FILE     *screen   = stdout;
+    Recorder *recorder = NULL;
+    if (record_path != NULL) {
+        recorder = RecorderOpen(record_path, FRAME_CAPACITY);
+        if (recorder == NULL) {
+            return 1;
+        }
+        screen = RecorderScreen(recorder);
     }
 
+    Metrics *metrics = MetricsOpen("solitaire");
+
     /* size_t seed = 1720019880; */
     /* size_t seed = 1720205317; */
-    size_t seed = time(NULL);
-    printf("Seed: %ld\n", seed);
-    srand(seed);
-    Pile deck = { .size = DECK_SIZE };
-    for (size_t i=0; i<deck.size; ++i) {
-        Card card     = { .number = i, .hidden = true };
-        deck.cards[i] = card;
-    }
-    for (size_t i=0; i<deck.size; ++i) {
-        int rand_index = rand() % deck.size;
-        Card tmp = deck.cards[i];
-        deck.cards[i] = deck.cards[rand_index];
-        deck.cards[rand_index] = tmp;
-    }
-    Pile poll           = { 0 };
-    Pile foundations[4] = { 0 }; 
-    Pile columns[7]     = { 0 };
-    for (size_t i=0; i<7; ++i) {
-        Pile column = { .size = i + 1 };
-        for (size_t j=0; j<column.size; ++j) {
-            column.cards[j] = deck.cards[deck.size - 1];
-            deck.size--;
-        }
-        LAST_CARD_OF(column).hidden = false;
-        columns[i] = column;
+    size_t seed = race != NULL ? race->seed : time(NULL);
+    Game game;
+    GameInit(&game, variant, seed, draw_count);
+    while (skip_dead && race == NULL && variant->find_dead_pattern(&game, NULL) != DEAD_NONE) {
+        GameInit(&game, variant, ++seed, draw_count);
     }
+    printf("Seed: %ld\n", seed);
+    FILE *log = log_path != NULL ? GameLogOpen(log_path, &game, seed) : NULL;
 
     int turn_count     = 0;
+    History history    = {0};
+    Analyst *analyst   = AnalystOpen(ANALYST_MEMORY, ANALYST_NODES);
+    char notice[128]   = {0};
     char status[256]   = {0};
     bool gameover      = false;
-    Pile *piles[] = { &foundations[0], &foundations[1], &foundations[2], &foundations[3], &poll, &deck,
-        &columns[0], &columns[1], &columns[2], &columns[3], &columns[4], &columns[5], &columns[6] };
-    const size_t pile_count = LEN(piles);
-    Selection selected = { .pile_idx = GetIndexOfPile(piles, pile_count, &deck), .card_idx = deck.size-1 };
-    deck.cards[deck.size-1].selected = true;
-    Selection dragged = { .pile_idx = -1, .card_idx = -1};
+    char warning[128]  = {0};
+    DeadPattern dead   = DEAD_NONE;
+    int dead_card      = -1;
+    size_t height      = 0;
+    uint64_t key_time  = 0;
+    int start_idx      = variant->deck_id >= 0 ? variant->deck_id : COLUMN_ID(&game, 0);
+    Selection selected = { .pile_idx = start_idx, .card_idx = PileSize(&game, start_idx) - 1 };
+    Selection dragged  = { .pile_idx = -1, .card_idx = -1 };
     while(!gameover) {
+        /* Warn Once the Game Cannot Be Won */
+        if (dead == DEAD_NONE && (dead = variant->find_dead_pattern(&game, &dead_card)) != DEAD_NONE) {
+            if (dead_card >= 0) {
+                snprintf(warning, sizeof(warning), "Unwinnable: %s (%c%c)! ",
+                    DeadPatternMessage(dead), rank_symbols[dead_card % 13], suite_symbols[(dead_card / 13) % 4]);
+            } else {
+                snprintf(warning, sizeof(warning), "Unwinnable: %s! ", DeadPatternMessage(dead));
+            }
+        }
+
         /* Print Game State */
-        memset(buffer, ' ', BOARD_SIZE * sizeof(uint32_t));
-        RenderPiles(buffer, &deck, &poll, columns, foundations, piles, selected.pile_idx);
-        PrintBuffer(buffer);
+        if (BoardHeight(&game) > height) {
+            height = BoardHeight(&game);
+        }
+        size_t written = PrintBoard(screen, &game, height, selected, dragged);
+        if (race != NULL) {
+            char progress[256];
+            RaceFormatStatus(race, progress, sizeof(progress));
+            written += fprintf(screen, "\x1B[2K%s\n", progress);
+        }
 
         /* Check Game Over */
-        if (IsGameFinished(foundations) == true) {
-            printf("\x1B[2KCongratulations! You solved it in %d turns.", turn_count);
+        if (IsGameFinished(&game) == true) {
+            written += fprintf(screen, "\x1B[2KCongratulations! You solved it in %d turns.", turn_count);
             gameover = true;
+        } else {
+            written += fprintf(screen, "\x1B[2K[Turn #%d] %s%s%s\n", turn_count, warning, notice, status);
+        }
+        if (recorder != NULL) {
+            RecorderPresent(recorder);
+        }
+        MetricsAdd(metrics, METRIC_FRAMES, 1);
+        MetricsAdd(metrics, METRIC_BYTES, written);
+        if (key_time != 0) {  /* Only Frames Answering a Key Press */
+            MetricsAdd(metrics, METRIC_REJECTED, status[0] != '\0');
+            MetricsLatency(metrics, MetricsNow() - key_time);
+        }
+        if (gameover) {
             break;
         }
 
+        /* Analyze the Position While the Player Thinks */
+        AnalystRequest(analyst, &game);
+
         /* Get User Input */
-        printf("\x1B[2K[Turn #%d] %s\n", turn_count, status);
+        int key_pressed = race != NULL ? GetKeyPressOrInput(race->fd) : GetKeyPress();
+        printf("\x1B[%zuF", height + 1 + (race != NULL));
+        if (key_pressed == KEY_INPUT) {  /* Another Player Moved */
+            RacePoll(race, 0);
+            key_time = 0;
+            continue;
+        }
+        if (key_pressed == EOF) {  /* Input Closed */
+            key_pressed = 'q';
+        }
         status[0] = '\0';
-        char key_pressed = GetKeyPress();
-        printf("\x1B[%dF", BOARD_HEIGHT + 1);
+        notice[0] = '\0';
+        key_time  = MetricsNow();
+        PileRole selected_role = game.infos[selected.pile_idx].role;
         switch (key_pressed) {
             case 'q': {  /* Quit */
                 gameover = true;
             } break;
+            case 'h': {  /* Pick Up the Suggested Move */
+                Analysis analysis;
+                if (analyst == NULL) {
+                    strcpy(status, "Hints are not available!");
+                    continue;
+                }
+                AnalystWait(analyst, &game, &analysis);
+                if (!analysis.has_hint) {
+                    strcpy(status, "There are no moves left!");
+                    continue;
+                }
+                Move hint = analysis.hint;
+                if (hint.kind == MOVE_DRAW) {
+                    dragged  = (Selection) { .pile_idx = -1, .card_idx = -1 };
+                    selected = (Selection) { .pile_idx = variant->deck_id, .card_idx = PileSize(&game, variant->deck_id) - 1 };
+                } else {
+                    dragged  = (Selection) { .pile_idx = hint.source, .card_idx = hint.depth };
+                    selected = (Selection) { .pile_idx = hint.target, .card_idx = PileSize(&game, hint.target) - 1 };
+                }
+                snprintf(notice, sizeof(notice), "Hint: press space to play it, the game is %s. ",
+                    analysis.result == SOLVE_WON ? "winnable" : analysis.result == SOLVE_LOST ? "lost" : "undecided");
+            } break;
+            case 'f': {  /* Play Every Safe Move to the Foundations */
+                Analysis analysis;
+                if (analyst == NULL) {
+                    strcpy(status, "Auto-moves are not available!");
+                    continue;
+                }
+                AnalystWait(analyst, &game, &analysis);
+                if (analysis.safe_count == 0) {
+                    strcpy(status, "No card can safely go to the foundations!");
+                    continue;
+                }
+                for (size_t i=0; i<analysis.safe_count && variant->check_move(&game, analysis.safe[i]) == NULL; ++i) {
+                    PlayMove(&game, analysis.safe[i], &turn_count, &history, metrics, race, log);
+                }
+                dragged  = (Selection) { .pile_idx = -1, .card_idx = -1 };
+                selected.card_idx = PileSize(&game, selected.pile_idx) - 1;
+            } break;
+            case 'u': {  /* Undo the Last Move */
+                if (race != NULL) {
+                    strcpy(status, "Moves cannot be taken back in a race!");
+                    continue;
+                }
+                if (history.count == 0) {
+                    strcpy(status, "Nothing to undo!");
+                    continue;
+                }
+                turn_count = UndoMove(&game, seed, &history);
+                GameLogUndo(log);
+                dead       = DEAD_NONE;
+                warning[0] = '\0';
+                dragged    = (Selection) { .pile_idx = -1, .card_idx = -1 };
+                selected.card_idx = PileSize(&game, selected.pile_idx) - 1;
+            } break;
             case 's': {  /* Traverse within Pile (only for columns) */
-                if (selected.pile_idx >= GetIndexOfPile(piles, pile_count, &columns[0])) {
-                    Pile *column = piles[selected.pile_idx];
-                    column->cards[selected.card_idx].selected = false;
+                if (selected_role == ROLE_COLUMN && game.piles[selected.pile_idx].size > 0) {
+                    Pile *column = &game.piles[selected.pile_idx];
                     selected.card_idx = MOD(selected.card_idx + 1, column->size);
-                    while (column->cards[selected.card_idx].hidden) {
+                    while (PILE_CARDS(&game, selected.pile_idx)[selected.card_idx].hidden) {
                         selected.card_idx = MOD(selected.card_idx + 1, column->size);
                     }
-                    column->cards[selected.card_idx].selected = true;
                 }
             } break;
             case 'w': {  /* Traverse within Pile (only for columns) */
-                if (selected.pile_idx >= GetIndexOfPile(piles, pile_count, &columns[0])) {
-                    Pile *column = piles[selected.pile_idx];
-                    column->cards[selected.card_idx].selected = false;
+                if (selected_role == ROLE_COLUMN && game.piles[selected.pile_idx].size > 0) {
+                    Pile *column = &game.piles[selected.pile_idx];
                     selected.card_idx = MOD(selected.card_idx - 1, column->size);
-                    while (column->cards[selected.card_idx].hidden) {
+                    while (PILE_CARDS(&game, selected.pile_idx)[selected.card_idx].hidden) {
                         selected.card_idx = MOD(selected.card_idx - 1, column->size);
                     }
-                    column->cards[selected.card_idx].selected = true;
                 }
             } break;
             case 'd': {  /* Traverse Piles Forward */
-                Pile *selected_pile                               = piles[selected.pile_idx];
-                selected_pile->cards[selected.card_idx].selected = false;
-                selected.pile_idx = MOD(selected.pile_idx + 1, pile_count);
-                selected_pile      = piles[selected.pile_idx];
-                if (selected_pile == &poll && poll.size == 0)  {
-                    selected.pile_idx = MOD(selected.pile_idx + 1, pile_count);
-                    selected_pile      = piles[selected.pile_idx];
-                }
-                selected.card_idx                                = selected_pile->size - 1;
-                if (selected.card_idx >= 0) {
-                    selected_pile->cards[selected.card_idx].selected = true;
+                selected.pile_idx = MOD(selected.pile_idx + 1, game.pile_count);
+                if (game.infos[selected.pile_idx].role == ROLE_POLL && game.stock.split == 0)  {
+                    selected.pile_idx = MOD(selected.pile_idx + 1, game.pile_count);
                 }
+                selected.card_idx = PileSize(&game, selected.pile_idx) - 1;
             } break;
             case 'a': {  /* Traverse Piles Backward */
-                Pile *selected_pile                               = piles[selected.pile_idx];
-                selected_pile->cards[selected.card_idx].selected = false;
-                selected.pile_idx = MOD(selected.pile_idx - 1, pile_count);
-                selected_pile     = piles[selected.pile_idx];
-                if (selected_pile == &poll && poll.size == 0)  {
-                    selected.pile_idx = MOD(selected.pile_idx - 1, pile_count);
-                    selected_pile      = piles[selected.pile_idx];
-                }
-                selected.card_idx                                = selected_pile->size - 1;
-                if (selected.card_idx >= 0) {
-                    selected_pile->cards[selected.card_idx].selected = true;
+                selected.pile_idx = MOD(selected.pile_idx - 1, game.pile_count);
+                if (game.infos[selected.pile_idx].role == ROLE_POLL && game.stock.split == 0)  {
+                    selected.pile_idx = MOD(selected.pile_idx - 1, game.pile_count);
                 }
+                selected.card_idx = PileSize(&game, selected.pile_idx) - 1;
             } break;
-            case 'e': {  /* Collect or Draw Cards */
-                if (dragged.pile_idx != -1 || dragged.card_idx != -1) {
-                    piles[dragged.pile_idx]->cards[dragged.card_idx].dragged = false;
-                    dragged.pile_idx = -1;
-                    dragged.card_idx = -1;
-                }
-                if (piles[selected.pile_idx] == &poll) {  /* Collect from Poll */
-                    int target_suite = SUITE_OF(LAST_CARD_OF(poll));
-                    if (!(
-                        (foundations[target_suite].size == 0 && RANK_OF(LAST_CARD_OF(poll)) == 0) ||
-                        (foundations[target_suite].size > 0  && RANK_OF(LAST_CARD_OF(poll)) == RANK_OF(LAST_CARD_OF(foundations[target_suite])) + 1)
-                    )) {
-                        strcpy(status, "Ranks not matching!");
-                        continue;
-                    }
-                    piles[selected.pile_idx]->cards[selected.card_idx].selected = false;
-                    foundations[target_suite].size++;
-                    LAST_CARD_OF(foundations[target_suite]) = LAST_CARD_OF(poll);
-                    poll.size--;
-                    selected.card_idx = piles[selected.pile_idx]->size - 1;
-                    if (selected.card_idx >= 0) {
-                        piles[selected.pile_idx]->cards[selected.card_idx].selected = true;
-                    }
-                    turn_count++;
-                } else if (selected.pile_idx >= GetIndexOfPile(piles, pile_count, &columns[0]) &&
-                            selected.pile_idx <= GetIndexOfPile(piles, pile_count, &columns[6])) {  /* Collect from Columns */
-                    int source_col = selected.pile_idx - GetIndexOfPile(piles, pile_count, &columns[0]);
-                    if (columns[source_col].size == 0) {
-                        strcpy(status, "That column is empty!");
+            case 'e': {  /* Collect Cards */
+                dragged.pile_idx = -1;
+                dragged.card_idx = -1;
+                if (selected_role == ROLE_POLL || selected_role == ROLE_CELL || selected_role == ROLE_COLUMN) {
+                    Move move = variant->collect_move(&game, selected.pile_idx);
+                    const char *error = variant->check_move(&game, move);
+                    if (error != NULL) {
+                        strcpy(status, error);
                         continue;
                     }
-                    int target_suite = SUITE_OF(LAST_CARD_OF(columns[source_col]));
-                    if (!(
-                        (foundations[target_suite].size == 0 && RANK_OF(LAST_CARD_OF(columns[source_col])) == 0) ||
-                        (foundations[target_suite].size > 0  && RANK_OF(LAST_CARD_OF(columns[source_col])) == RANK_OF(LAST_CARD_OF(foundations[target_suite])) + 1)
-                    )) {
-                        strcpy(status, "Ranks not matching!");
-                        continue;
-                    }
-                    piles[selected.pile_idx]->cards[selected.card_idx].selected = false;
-                    foundations[target_suite].size++;
-                    LAST_CARD_OF(foundations[target_suite]) = LAST_CARD_OF(columns[source_col]);
-                    columns[source_col].size--;
-                    LAST_CARD_OF(columns[source_col]).hidden = false;
-                    selected.card_idx = piles[selected.pile_idx]->size - 1;
-                    if (selected.card_idx >= 0) {
-                        piles[selected.pile_idx]->cards[selected.card_idx].selected = true;
-                    }
-                    turn_count++;
+                    PlayMove(&game, move, &turn_count, &history, metrics, race, log);
+                    selected.card_idx = PileSize(&game, selected.pile_idx) - 1;
                 }
             } break;
             case ' ': {  /* Move Cards */
-                if (piles[selected.pile_idx] == &deck) {  /* Draw Cards */
-                    if (dragged.pile_idx != -1 || dragged.card_idx != -1) {
-                        piles[dragged.pile_idx]->cards[dragged.card_idx].dragged = false;
-                        dragged.pile_idx = -1;
-                        dragged.card_idx = -1;
-                    }
-                    deck.cards[selected.card_idx].selected = false;
-                    int buyout_size = deck.size > 3 ? 3 : deck.size;
-                    if (buyout_size == 0) {
-                        while(poll.size > 0) {
-                            deck.size++;
-                            LAST_CARD_OF(deck)        = LAST_CARD_OF(poll);
-                            LAST_CARD_OF(deck).hidden = true;
-                            poll.size--;
-                        }
-                    } else {
-                        for (int i=0; i<buyout_size; ++i) {
-                            poll.size++;
-                            LAST_CARD_OF(poll)        = LAST_CARD_OF(deck);
-                            LAST_CARD_OF(poll).hidden = false;
-                            deck.size--;
-                        }
-                        turn_count++;
-                    }
-                    selected.card_idx = deck.size - 1;
-                    deck.cards[selected.card_idx].selected = true;
-                } else if (dragged.pile_idx == -1 && dragged.card_idx == -1 && piles[selected.pile_idx]->size > 0) {
-                    dragged.pile_idx = selected.pile_idx;
-                    dragged.card_idx = selected.card_idx;
-                    piles[dragged.pile_idx]->cards[dragged.card_idx].dragged = true;
-                } else if (dragged.pile_idx == selected.pile_idx && dragged.card_idx == selected.card_idx) {
-                    if (piles[dragged.pile_idx]->size > 0) {
-                        piles[dragged.pile_idx]->cards[dragged.card_idx].dragged = false;
-                    }
+                if (selected_role == ROLE_DECK) {  /* Draw Cards */
                     dragged.pile_idx = -1;
                     dragged.card_idx = -1;
-                } else if (piles[dragged.pile_idx] == &poll) {  /* Move Poll to Col */
-                    int target_col  = selected.pile_idx - GetIndexOfPile(piles, pile_count, &columns[0]);
-                    if (selected.card_idx != columns[target_col].size - 1) {
-                        strcpy(status, "You can only move cards from poll to the end of column piles!");
+                    Move move = { .kind = MOVE_DRAW, .source = selected.pile_idx, .target = selected.pile_idx };
+                    const char *error = variant->check_move(&game, move);
+                    if (error != NULL) {
+                        strcpy(status, error);
                         continue;
                     }
-                    if (!(
-                        (columns[target_col].size == 0 && RANK_OF(LAST_CARD_OF(poll)) == 12) ||
-                        (columns[target_col].size > 0  && 
-                            (RANK_OF(LAST_CARD_OF(poll)) + 1 == RANK_OF(LAST_CARD_OF(columns[target_col]))) &&
-                            (SUITE_OF(LAST_CARD_OF(poll)) / 2 != SUITE_OF(LAST_CARD_OF(columns[target_col])) / 2)
-                    ))) {
-                        strcpy(status, "Ranks or Suites not matching!");
-                        continue;
-                    }
-                    piles[dragged.pile_idx]->cards[dragged.card_idx].dragged = false;
-                    dragged.pile_idx = -1;
-                    dragged.card_idx = -1;
-                    columns[target_col].size++;
-                    LAST_CARD_OF(columns[target_col]) = LAST_CARD_OF(poll);
-                    poll.size--;
-                    piles[selected.pile_idx]->cards[selected.card_idx].selected = false;
-                    selected.card_idx = columns[target_col].size - 1;
-                    piles[selected.pile_idx]->cards[selected.card_idx].selected = true;
-                    turn_count++;
-                } else if (dragged.pile_idx >= GetIndexOfPile(piles, pile_count, &foundations[0]) &&   /* Move Foundation to Col */
-                            dragged.pile_idx <= GetIndexOfPile(piles, pile_count, &foundations[3])) {
-                    int source_suite  = dragged.pile_idx - GetIndexOfPile(piles, pile_count, &foundations[0]);
-                    int target_col  = selected.pile_idx - GetIndexOfPile(piles, pile_count, &columns[0]);
-                    if (foundations[source_suite].size == 0) {
-                        strcpy(status, "That foundation pile is empty!");
-                        continue;
-                    }
-                    if (selected.card_idx != columns[target_col].size - 1) {
-                        strcpy(status, "You can only move cards from foundation piles to the end of column piles!");
-                        continue;
-                    }
-                    if (!(
-                        (columns[target_col].size == 0 && RANK_OF(LAST_CARD_OF(foundations[source_suite])) == 12) ||
-                        (columns[target_col].size > 0  && 
-                            (RANK_OF(LAST_CARD_OF(foundations[source_suite])) + 1 == RANK_OF(LAST_CARD_OF(columns[target_col]))) &&
-                            (SUITE_OF(LAST_CARD_OF(foundations[source_suite])) / 2 != SUITE_OF(LAST_CARD_OF(columns[target_col])) / 2)
-                    ))) {
-                        strcpy(status, "Ranks or Suites not matching!");
-                        continue;
-                    }
-                    piles[dragged.pile_idx]->cards[dragged.card_idx].dragged = false;
+                    PlayMove(&game, move, &turn_count, &history, metrics, race, log);
+                    selected.card_idx = PileSize(&game, selected.pile_idx) - 1;
+                } else if (dragged.pile_idx == -1 && dragged.card_idx == -1 && PileSize(&game, selected.pile_idx) > 0) {
+                    dragged = selected;
+                } else if (IsSelected(dragged, selected.pile_idx, selected.card_idx)) {
                     dragged.pile_idx = -1;
                     dragged.card_idx = -1;
-                    columns[target_col].size++;
-                    LAST_CARD_OF(columns[target_col]) = LAST_CARD_OF(foundations[source_suite]);
-                    foundations[source_suite].size--;
-                    piles[selected.pile_idx]->cards[selected.card_idx].selected = false;
-                    selected.card_idx = columns[target_col].size - 1;
-                    piles[selected.pile_idx]->cards[selected.card_idx].selected = true;
-                    turn_count++;
-                } else if (dragged.pile_idx >= GetIndexOfPile(piles, pile_count, &columns[0]) &&   /* Move Col to Col */
-                            dragged.pile_idx <= GetIndexOfPile(piles, pile_count, &columns[6])) {
-                    int card_idx = dragged.card_idx;
-                    int source_col = dragged.pile_idx - GetIndexOfPile(piles, pile_count, &columns[0]);
-                    int target_col = selected.pile_idx - GetIndexOfPile(piles, pile_count, &columns[0]);
-                    if (selected.card_idx != columns[target_col].size - 1) {
-                        strcpy(status, "You can only move cards from cards to the end of column piles!");
+                } else if (dragged.pile_idx != -1) {  /* Drop Cards */
+                    if (selected_role == ROLE_COLUMN && selected.card_idx != (int) game.piles[selected.pile_idx].size - 1) {
+                        strcpy(status, "You can only move cards to the end of column piles!");
                         continue;
                     }
-                    if (!(
-                        (columns[target_col].size == 0 && RANK_OF(columns[source_col].cards[card_idx]) == 12) ||
-                        (columns[target_col].size > 0  && 
-                            (RANK_OF(columns[source_col].cards[card_idx]) + 1 == RANK_OF(LAST_CARD_OF(columns[target_col]))) &&
-                            (SUITE_OF(columns[source_col].cards[card_idx]) / 2 != SUITE_OF(LAST_CARD_OF(columns[target_col])) / 2)
-                    ))) {
-                        strcpy(status, "Ranks or Suites not matching!");
+                    Move move = { .kind = MOVE_CARDS, .source = dragged.pile_idx, .depth = dragged.card_idx, .target = selected.pile_idx };
+                    const char *error = variant->check_move(&game, move);
+                    if (error != NULL) {
+                        strcpy(status, error);
                         continue;
                     }
-                    piles[dragged.pile_idx]->cards[dragged.card_idx].dragged = false;
                     dragged.pile_idx = -1;
                     dragged.card_idx = -1;
-                    piles[selected.pile_idx]->cards[selected.card_idx].selected = false;
-                    for (int i=0; i<columns[source_col].size - card_idx; i++) {
-                        columns[target_col].size++;
-                        LAST_CARD_OF(columns[target_col]) = columns[source_col].cards[card_idx + i];
-                    }
-                    columns[source_col].size = card_idx;
-                    LAST_CARD_OF(columns[source_col]).hidden = false;
-                    selected.card_idx = columns[target_col].size - 1;
-                    piles[selected.pile_idx]->cards[selected.card_idx].selected = true;
-                    turn_count++;
+                    PlayMove(&game, move, &turn_count, &history, metrics, race, log);
+                    selected.card_idx = PileSize(&game, selected.pile_idx) - 1;
                 }
             } break;
         }
     }
 
-    printf("\x1B[%dB", BOARD_HEIGHT + 2);
-    free(buffer);
+    printf("\x1B[%zuB", height + 2 + (race != NULL));
+    RecorderClose(recorder);
+    MetricsClose(metrics);
+    RaceLeave(race);
+    AnalystClose(analyst);
+    if (log != NULL) {
+        fclose(log);
+    }
+    free(history.moves);
 	return 0;
 }
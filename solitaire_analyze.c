@@ -0,0 +1,219 @@
+#define VERSION "1.0"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define STB_SOLITAIRE_IMPLEMENTATION
+#include "stb_solitaire.h"
+#define STB_SOLVER_IMPLEMENTATION
+#include "stb_solver.h"
+
+#define MAX_MISTAKES 32
+
+const char suite_symbols[] = { 'H', 'D', 'S', 'C' };
+const char rank_symbols[]  = { 'A', '2', '3', '4', '5', '6', '7', '8', '9', 'T', 'J', 'Q', 'K' };
+const char *result_names[] = { "winnable", "lost", "unknown" };
+
+/* The positions a known solution passes through, so that later positions reached by the player can be recognized
+ * as winnable without searching them again. Positions are matched exactly, pile order included, since the moves of
+ * the path name piles. */
+typedef struct Path {
+    uint64_t *keys;
+    Move     *moves;
+    size_t    length;
+    size_t    capacity;
+} Path;
+
+typedef struct Mistake {
+    size_t      index;
+    char        move[48];
+    char        hint[48];
+    SolveResult after;
+} Mistake;
+
+double NowSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void FormatPile(const Game *game, int pile_id, char *buffer, size_t size)
+{
+    PileInfo info = game->infos[pile_id];
+    switch (info.role) {
+        case ROLE_FOUNDATION: snprintf(buffer, size, "fnd %d", info.ordinal + 1); break;
+        case ROLE_CELL:       snprintf(buffer, size, "cell %d", info.ordinal + 1); break;
+        case ROLE_POLL:       snprintf(buffer, size, "poll"); break;
+        case ROLE_DECK:       snprintf(buffer, size, "deck"); break;
+        default:              snprintf(buffer, size, "col %d", info.ordinal + 1); break;
+    }
+}
+
+void FormatMove(const Game *game, Move move, char *buffer, size_t size)
+{
+    if (move.kind == MOVE_DRAW) {
+        snprintf(buffer, size, game->variant->poll_id >= 0 ? "draw" : "deal");
+        return;
+    }
+    char source[16], target[16];
+    Card card = PileCard(game, move.source, move.depth);
+    FormatPile(game, move.source, source, sizeof(source));
+    FormatPile(game, move.target, target, sizeof(target));
+    snprintf(buffer, size, "%c%c %s to %s", rank_symbols[RANK_OF(card)], suite_symbols[SUITE_OF(card)], source, target);
+}
+
+/* Replays `solution` from `game` and keeps every position it passes through. */
+bool PathBuild(Path *path, const Game *game, const Move solution[], size_t length)
+{
+    if (length + 1 > path->capacity) {
+        size_t    capacity = 2 * (length + 1);
+        uint64_t *keys     = realloc(path->keys, capacity * sizeof(uint64_t));
+        if (keys == NULL) {
+            return false;
+        }
+        path->keys = keys;
+        Move *moves = realloc(path->moves, capacity * sizeof(Move));
+        if (moves == NULL) {
+            return false;
+        }
+        path->moves    = moves;
+        path->capacity = capacity;
+    }
+    Game copy = *game;
+    path->length = length + 1;
+    for (size_t i=0; i<=length; ++i) {
+        path->keys[i] = ExactPositionKey(&copy);
+        if (i < length) {
+            path->moves[i] = solution[i];
+            copy.variant->apply_move(&copy, solution[i]);
+        }
+    }
+    return true;
+}
+
+/* Index of the position in the path, -1 if the solution does not go through it. */
+long PathFind(const Path *path, uint64_t key)
+{
+    for (size_t i=0; i<path->length; ++i) {
+        if (path->keys[i] == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *log_path   = NULL;
+    size_t      memory_mb  = 64;
+    size_t      node_limit = 200000;
+    bool        quiet      = false;
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (sscanf(argv[i], "--memory=%zu", &memory_mb) == 1 && memory_mb > 0) {
+            continue;
+        } else if (sscanf(argv[i], "--nodes=%zu", &node_limit) == 1) {
+            continue;
+        } else if (argv[i][0] != '-' && log_path == NULL) {
+            log_path = argv[i];
+        } else {
+            log_path = NULL;
+            break;
+        }
+    }
+    if (log_path == NULL) {
+        fprintf(stderr, "Usage: %s [--memory=MB] [--nodes=N] [--quiet] LOG\n", argv[0]);
+        return 1;
+    }
+
+    const Variant *variant;
+    unsigned int   seed;
+    size_t         draw_count, move_count;
+    Move          *moves = GameLogLoad(log_path, &variant, &seed, &draw_count, &move_count);
+    if (moves == NULL) {
+        return 1;
+    }
+    Solver solver = { .node_limit = node_limit, .table = TableOpen(memory_mb << 20, NULL, 0) };
+    if (solver.table == NULL) {
+        free(moves);
+        return 1;
+    }
+
+    /* A position is winnable if a known solution passes through it exactly. A position after a lost one is lost
+     * too, and the table keeps every position proven lost, so only positions off the last solution are searched. */
+    Game        game;
+    Path        path     = {0};
+    SolveResult result   = SOLVE_UNKNOWN;
+    SolveResult start    = SOLVE_UNKNOWN;
+    Mistake     mistakes[MAX_MISTAKES];
+    size_t      mistake_count = 0, searches = 0, nodes = 0, played = 0;
+    char        move_text[48], hint_text[48] = "-";
+    double      started  = NowSeconds();
+    GameInit(&game, variant, seed, draw_count);
+    for (size_t i=0; i<=move_count; ++i) {
+        SolveResult previous = result;
+        long        on_path  = result == SOLVE_LOST ? -1 : PathFind(&path, ExactPositionKey(&game));
+        if (on_path >= 0) {
+            result = SOLVE_WON;
+        } else if (result != SOLVE_LOST) {
+            result = Solve(&solver, &game);
+            searches++;
+            nodes += solver.nodes;
+            on_path = 0;
+            if (result == SOLVE_WON && !PathBuild(&path, &game, solver.solution, solver.solution_length)) {
+                fprintf(stderr, "%s:%d: Couldn't allocate path memory\n", __FILE__, __LINE__);
+                break;
+            }
+        }
+        if (i == 0) {
+            start = result;
+        } else {
+            bool mistake = previous == SOLVE_WON && result != SOLVE_WON;
+            if (!quiet || mistake) {
+                printf("%4zu. %-24s %-8s%s\n", i, move_text, result_names[result],
+                    !mistake ? "" : result == SOLVE_LOST ? "  <- loses the game" : "  <- may lose the game");
+            }
+            if (mistake && mistake_count < MAX_MISTAKES) {
+                mistakes[mistake_count] = (Mistake) { .index = i, .after = result };
+                memcpy(mistakes[mistake_count].move, move_text, sizeof(move_text));
+                memcpy(mistakes[mistake_count].hint, hint_text, sizeof(hint_text));
+                mistake_count++;
+            }
+        }
+        if (i == move_count) {
+            break;
+        }
+        if (variant->check_move(&game, moves[i]) != NULL) {
+            fprintf(stderr, "%s:%d: Move %zu of %s is not legal\n", __FILE__, __LINE__, i + 1, log_path);
+            break;
+        }
+        strcpy(hint_text, "-");
+        if (result == SOLVE_WON && (size_t) on_path + 1 < path.length) {
+            FormatMove(&game, path.moves[on_path], hint_text, sizeof(hint_text));
+        }
+        FormatMove(&game, moves[i], move_text, sizeof(move_text));
+        variant->apply_move(&game, moves[i]);
+        played++;
+    }
+
+    printf("\n%s draw %zu seed %u: %zu moves, deal %s, final position %s\n", variant->name, draw_count, seed, played,
+        result_names[start], result_names[result]);
+    printf("%zu of %zu positions searched, %zu nodes, %.2f s\n", searches, played + 1, nodes, NowSeconds() - started);
+    printf("%zu critical mistake%s\n", mistake_count, mistake_count == 1 ? "" : "s");
+    for (size_t i=0; i<mistake_count; ++i) {
+        printf("  move %zu: %s left the game %s, the solver played %s\n", mistakes[i].index, mistakes[i].move,
+            result_names[mistakes[i].after], mistakes[i].hint);
+    }
+    free(path.keys);
+    free(path.moves);
+    free(moves);
+    SolverFree(&solver);
+    TableClose(solver.table);
+	return 0;
+}
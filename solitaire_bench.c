@@ -0,0 +1,315 @@
+#define VERSION "1.0"
+#define _XOPEN_SOURCE 600
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+
+#define MAX_INPUTS     64
+#define MAX_SAMPLES    100000
+#define FRAME_MARKER   "[Turn #"
+#define BACKLOG_FRAMES 16
+
+/* A program running on the slave side of a pseudo-terminal, seen through the master. Frames are found in its
+ * output by the status line both frontends print last: "[Turn #" up to the end of the line for the interactive
+ * version, up to the prompt for the command-based one. */
+typedef struct Session {
+    int    master;
+    pid_t  pid;
+    size_t matched;
+    bool   in_status;
+    size_t frames;
+    size_t bytes;
+    size_t frame_bytes;
+} Session;
+
+/* A scripted input: one key for the interactive version, one command line for the command-based one. */
+typedef struct Input {
+    const char *text;
+    size_t      length;
+} Input;
+
+uint64_t NowMicroseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+bool SessionStart(Session *session, char *argv[])
+{
+    memset(session, 0, sizeof(Session));
+    session->master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (session->master < 0 || grantpt(session->master) != 0 || unlockpt(session->master) != 0) {
+        fprintf(stderr, "%s:%d: Couldn't open a pseudo-terminal\n", __FILE__, __LINE__);
+        return false;
+    }
+    struct winsize size = { .ws_row = 200, .ws_col = 200 };
+    ioctl(session->master, TIOCSWINSZ, &size);
+    const char *slave = ptsname(session->master);
+    fflush(stdout);
+    session->pid = fork();
+    if (session->pid == 0) {
+        setsid();
+        int fd = open(slave, O_RDWR);
+        if (fd < 0) {
+            _exit(127);
+        }
+        ioctl(fd, TIOCSCTTY, 0);
+        dup2(fd, STDIN_FILENO);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+        close(session->master);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    return session->pid > 0;
+}
+
+void SessionStop(Session *session, Input quit)
+{
+    if (write(session->master, quit.text, quit.length) < 0 || session->pid <= 0) {
+        kill(session->pid, SIGTERM);
+    }
+    char     buffer[4096];
+    uint64_t deadline = NowMicroseconds() + 1000000;
+    struct pollfd fds = { .fd = session->master, .events = POLLIN };
+    while (NowMicroseconds() < deadline && poll(&fds, 1, 100) >= 0 && waitpid(session->pid, NULL, WNOHANG) == 0) {
+        if (fds.revents & POLLIN && read(session->master, buffer, sizeof(buffer)) <= 0) {
+            break;
+        }
+    }
+    if (waitpid(session->pid, NULL, WNOHANG) == 0) {
+        kill(session->pid, SIGKILL);
+        waitpid(session->pid, NULL, 0);
+    }
+    close(session->master);
+}
+
+/* Feeds output to the frame scanner and returns the number of frames it completed. */
+size_t SessionScan(Session *session, const char *data, size_t size)
+{
+    size_t completed = 0;
+    for (size_t i=0; i<size; ++i) {
+        session->frame_bytes++;
+        char c = data[i];
+        if (session->in_status) {
+            if (c == '\n' || c == '>') {
+                session->in_status = false;
+                session->bytes    += session->frame_bytes;
+                session->frame_bytes = 0;
+                session->frames++;
+                completed++;
+            }
+        } else if (c == FRAME_MARKER[session->matched]) {
+            session->in_status = ++session->matched == strlen(FRAME_MARKER);
+            session->matched   = session->in_status ? 0 : session->matched;
+        } else {
+            session->matched = c == FRAME_MARKER[0];
+        }
+    }
+    return completed;
+}
+
+/* Reads whatever output arrives within `timeout_us`. Returns the number of frames completed, or -1 once the
+ * program has exited. */
+int SessionRead(Session *session, uint64_t timeout_us)
+{
+    char buffer[65536];
+    struct pollfd fds = { .fd = session->master, .events = POLLIN };
+    int ready = poll(&fds, 1, (int) ((timeout_us + 999) / 1000));
+    if (ready <= 0) {
+        return 0;
+    }
+    ssize_t count = read(session->master, buffer, sizeof(buffer));
+    if (count <= 0) {
+        return -1;
+    }
+    return SessionScan(session, buffer, count);
+}
+
+/* Waits for the program to finish `frames` frames in total. Returns false on timeout or exit. */
+bool SessionWaitFrames(Session *session, size_t frames, uint64_t timeout_us)
+{
+    uint64_t deadline = NowMicroseconds() + timeout_us;
+    while (session->frames < frames) {
+        uint64_t now = NowMicroseconds();
+        if (now >= deadline || SessionRead(session, deadline - now) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int CompareSamples(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+uint64_t Percentile(const uint64_t *sorted, size_t count, double fraction)
+{
+    size_t index = (size_t) (fraction * count);
+    return sorted[index < count ? index : count - 1];
+}
+
+/* Sends one input at a time and waits for its frame, timing the round trip through the terminal. */
+bool MeasureLatency(Session *session, const Input inputs[], size_t input_count, size_t samples, uint64_t timeout_us)
+{
+    uint64_t *latencies = malloc(samples * sizeof(uint64_t));
+    if (latencies == NULL) {
+        return false;
+    }
+    size_t bytes_before = session->bytes;
+    size_t measured     = 0;
+    for (; measured<samples; ++measured) {
+        Input    input = inputs[measured % input_count];
+        uint64_t sent  = NowMicroseconds();
+        if (write(session->master, input.text, input.length) != (ssize_t) input.length ||
+            !SessionWaitFrames(session, session->frames + 1, timeout_us)
+        ) {
+            fprintf(stderr, "%s:%d: No frame after input %zu\n", __FILE__, __LINE__, measured);
+            break;
+        }
+        latencies[measured] = NowMicroseconds() - sent;
+    }
+    if (measured == 0) {
+        free(latencies);
+        return false;
+    }
+    qsort(latencies, measured, sizeof(uint64_t), CompareSamples);
+    printf("latency over %zu frames: p50 %llu us, p90 %llu us, p99 %llu us, p99.9 %llu us, max %llu us\n", measured,
+        (unsigned long long) Percentile(latencies, measured, 0.50), (unsigned long long) Percentile(latencies, measured, 0.90),
+        (unsigned long long) Percentile(latencies, measured, 0.99), (unsigned long long) Percentile(latencies, measured, 0.999),
+        (unsigned long long) latencies[measured - 1]);
+    printf("output: %.0f bytes per frame\n", (double) (session->bytes - bytes_before) / measured);
+    free(latencies);
+    return measured == samples;
+}
+
+/* Sends `count` inputs at a fixed rate without waiting for frames. Returns false if the frames fell more than
+ * BACKLOG_FRAMES behind the inputs at any point. */
+bool SustainRate(Session *session, const Input inputs[], size_t input_count, size_t count, double rate, uint64_t timeout_us, double *frame_rate)
+{
+    size_t   first   = session->frames;
+    size_t   backlog = 0;
+    uint64_t started = NowMicroseconds();
+    for (size_t sent=0; sent<count; ++sent) {
+        uint64_t due = started + (uint64_t) (sent * 1e6 / rate);
+        for (uint64_t now=NowMicroseconds(); now<due; now=NowMicroseconds()) {
+            if (SessionRead(session, due - now) < 0) {
+                return false;
+            }
+        }
+        Input input = inputs[sent % input_count];
+        if (write(session->master, input.text, input.length) != (ssize_t) input.length) {
+            return false;
+        }
+        size_t behind = sent + 1 - (session->frames - first);
+        backlog = behind > backlog ? behind : backlog;
+    }
+    bool drained = SessionWaitFrames(session, first + count, timeout_us);
+    *frame_rate  = (session->frames - first) * 1e6 / (NowMicroseconds() - started);
+    return drained && backlog <= BACKLOG_FRAMES;
+}
+
+/* Splits `script` into inputs: every character is a key, or with `lines` every comma separated command. */
+size_t ParseScript(char *script, bool lines, Input inputs[], char storage[][128])
+{
+    size_t count = 0;
+    if (!lines) {
+        for (size_t i=0; script[i] != '\0' && count<MAX_INPUTS; ++i) {
+            inputs[count++] = (Input) { .text = &script[i], .length = 1 };
+        }
+        return count;
+    }
+    for (char *command = strtok(script, ","); command != NULL && count<MAX_INPUTS; command = strtok(NULL, ",")) {
+        snprintf(storage[count], sizeof(storage[count]), "%s\n", command);
+        inputs[count] = (Input) { .text = storage[count], .length = strlen(storage[count]) };
+        count++;
+    }
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    char    *script     = NULL;
+    bool     lines      = false;
+    size_t   samples    = 2000;
+    size_t   burst      = 500;
+    double   rate       = 250.0;
+    double   max_rate   = 64000.0;
+    unsigned timeout_ms = 2000;
+    int      first_arg  = argc;
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "--") == 0) {
+            first_arg = i + 1;
+            break;
+        } else if (strncmp(argv[i], "--keys=", 7) == 0) {
+            script = argv[i] + 7;
+            lines  = false;
+        } else if (strncmp(argv[i], "--lines=", 8) == 0) {
+            script = argv[i] + 8;
+            lines  = true;
+        } else if (sscanf(argv[i], "--samples=%zu", &samples) == 1 && samples > 0 && samples <= MAX_SAMPLES) {
+            continue;
+        } else if (sscanf(argv[i], "--burst=%zu", &burst) == 1 && burst > 0) {
+            continue;
+        } else if (sscanf(argv[i], "--max-rate=%lf", &max_rate) == 1 && max_rate > 0) {
+            continue;
+        } else if (sscanf(argv[i], "--timeout=%u", &timeout_ms) == 1 && timeout_ms > 0) {
+            continue;
+        } else if (sscanf(argv[i], "--rate=%lf", &rate) != 1 || rate <= 0) {
+            fprintf(stderr, "Usage: %s [--keys=KEYS|--lines=COMMAND,...] [--samples=N] [--burst=N] [--rate=KEYS_PER_SECOND] [--max-rate=KEYS_PER_SECOND] [--timeout=MILLISECONDS] [-- PROGRAM ARGS...]\n", argv[0]);
+            return 1;
+        }
+    }
+    char *default_program[] = { "./solitaire", NULL };
+    char **program = first_arg < argc ? &argv[first_arg] : default_program;
+    char default_keys[] = "dddddddaaaaaaa", default_lines[] = "buy";
+    if (script == NULL) {
+        lines  = strstr(program[0], "noesc") != NULL;
+        script = lines ? default_lines : default_keys;
+    }
+    Input  inputs[MAX_INPUTS];
+    char   storage[MAX_INPUTS][128];
+    size_t input_count = ParseScript(script, lines, inputs, storage);
+    Input  quit        = lines ? (Input) { "quit\n", 5 } : (Input) { "q", 1 };
+    if (input_count == 0) {
+        fprintf(stderr, "%s:%d: Empty input script\n", __FILE__, __LINE__);
+        return 1;
+    }
+    uint64_t timeout_us = (uint64_t) timeout_ms * 1000;
+
+    Session session;
+    if (!SessionStart(&session, program) || !SessionWaitFrames(&session, 1, timeout_us)) {
+        fprintf(stderr, "%s:%d: %s did not draw a frame\n", __FILE__, __LINE__, program[0]);
+        return 1;
+    }
+    bool ok = MeasureLatency(&session, inputs, input_count, samples, timeout_us);
+
+    double sustained = 0.0, sustained_frames = 0.0, frame_rate = 0.0;
+    for (; ok && rate <= max_rate; rate *= 2) {
+        if (!SustainRate(&session, inputs, input_count, burst, rate, timeout_us, &frame_rate)) {
+            printf("throughput: backlog at %.0f keys/s\n", rate);
+            break;
+        }
+        sustained        = rate;
+        sustained_frames = frame_rate;
+    }
+    if (ok) {
+        printf("throughput: sustained %.0f keys/s, %.0f frames/s\n", sustained, sustained_frames);
+    }
+    SessionStop(&session, quit);
+	return ok ? 0 : 1;
+}
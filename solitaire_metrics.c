@@ -0,0 +1,152 @@
+#define VERSION "1.0"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <dirent.h>
+#include <signal.h>
+#include <errno.h>
+
+#define STB_METRICS_IMPLEMENTATION
+#include "stb_metrics.h"
+
+#define MAX_INSTANCES 64
+
+typedef struct Sample {
+    int32_t  pid;
+    char     program[28];
+    uint64_t started;
+    uint64_t counters[METRIC_COUNT];
+    uint64_t latency[METRICS_LATENCY_BUCKETS];
+} Sample;
+
+/* Copies every live segment out of shared memory. Segments left behind by processes that died without closing
+ * them are removed. */
+size_t TakeSamples(Sample *samples, size_t capacity)
+{
+    DIR *directory = opendir(METRICS_DIRECTORY);
+    if (directory == NULL) {
+        fprintf(stderr, "%s:%d: Couldn't open %s\n", __FILE__, __LINE__, METRICS_DIRECTORY);
+        return 0;
+    }
+    size_t count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(directory)) != NULL && count < capacity) {
+        if (strncmp(entry->d_name, METRICS_PREFIX, strlen(METRICS_PREFIX)) != 0) {
+            continue;
+        }
+        Metrics *metrics = MetricsAttach(entry->d_name);
+        if (metrics == NULL) {
+            continue;
+        }
+        if (kill(metrics->pid, 0) != 0 && errno == ESRCH) {
+            char name[300];
+            snprintf(name, sizeof(name), "/%s", entry->d_name);
+            shm_unlink(name);
+            MetricsDetach(metrics);
+            continue;
+        }
+        Sample *sample = &samples[count++];
+        sample->pid     = metrics->pid;
+        sample->started = metrics->started;
+        memcpy(sample->program, metrics->program, sizeof(sample->program));
+        sample->program[sizeof(sample->program) - 1] = '\0';
+        for (size_t i=0; i<METRIC_COUNT; ++i) {
+            sample->counters[i] = atomic_load_explicit(&metrics->counters[i], memory_order_relaxed);
+        }
+        for (size_t i=0; i<METRICS_LATENCY_BUCKETS; ++i) {
+            sample->latency[i] = atomic_load_explicit(&metrics->latency[i], memory_order_relaxed);
+        }
+        MetricsDetach(metrics);
+    }
+    closedir(directory);
+    return count;
+}
+
+/* Upper bound of the bucket holding the given fraction of all latency samples, in microseconds. */
+uint64_t LatencyPercentile(const Sample *sample, double fraction)
+{
+    uint64_t total = 0;
+    for (size_t i=0; i<METRICS_LATENCY_BUCKETS; ++i) {
+        total += sample->latency[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t seen = 0;
+    for (size_t i=0; i<METRICS_LATENCY_BUCKETS; ++i) {
+        seen += sample->latency[i];
+        if (seen >= fraction * total) {
+            return 1ull << i;
+        }
+    }
+    return 1ull << (METRICS_LATENCY_BUCKETS - 1);
+}
+
+const Sample *FindSample(const Sample *samples, size_t count, int32_t pid)
+{
+    for (size_t i=0; i<count; ++i) {
+        if (samples[i].pid == pid) {
+            return &samples[i];
+        }
+    }
+    return NULL;
+}
+
+void PrintSamples(const Sample *previous, size_t previous_count, const Sample *current, size_t current_count, double seconds)
+{
+    printf("%8s %-16s %8s %10s %10s %9s %9s %11s %11s\n",
+        "PID", "PROGRAM", "UPTIME", "FRAMES/s", "KB/s", "MOVES/s", "REJECT/s", "LAT p50 us", "LAT p99 us");
+    for (size_t i=0; i<current_count; ++i) {
+        const Sample *sample = &current[i];
+        const Sample *before = FindSample(previous, previous_count, sample->pid);
+        double rates[METRIC_COUNT] = {0};
+        for (size_t j=0; j<METRIC_COUNT && before != NULL && seconds > 0.0; ++j) {
+            rates[j] = (sample->counters[j] - before->counters[j]) / seconds;
+        }
+        printf("%8d %-16s %7llds %10.1f %10.1f %9.1f %9.1f %11llu %11llu\n",
+            sample->pid, sample->program, (long long) (time(NULL) - sample->started),
+            rates[METRIC_FRAMES], rates[METRIC_BYTES] / 1024.0, rates[METRIC_MOVES], rates[METRIC_REJECTED],
+            (unsigned long long) LatencyPercentile(sample, 0.50), (unsigned long long) LatencyPercentile(sample, 0.99));
+    }
+    if (current_count == 0) {
+        printf("No running sessions.\n");
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    double interval = 1.0;
+    bool   once     = false;
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "--once") == 0) {
+            once = true;
+        } else if (sscanf(argv[i], "--interval=%lf", &interval) != 1 || interval <= 0.0) {
+            fprintf(stderr, "Usage: %s [--interval=SECONDS] [--once]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Sample samples[2][MAX_INSTANCES];
+    size_t counts[2] = {0};
+    int    current   = 0;
+    counts[current]  = TakeSamples(samples[current], MAX_INSTANCES);
+    for (;;) {
+        struct timespec duration = { .tv_sec = (time_t) interval, .tv_nsec = (interval - (time_t) interval) * 1e9 };
+        nanosleep(&duration, NULL);
+        current = 1 - current;
+        counts[current] = TakeSamples(samples[current], MAX_INSTANCES);
+        if (!once) {
+            printf("\x1B[H\x1B[2J");
+        }
+        PrintSamples(samples[1 - current], counts[1 - current], samples[current], counts[current], interval);
+        if (once) {
+            break;
+        }
+    }
+	return 0;
+}
@@ -6,6 +6,13 @@
 #include <stdbool.h>
 #include <time.h>
 
+#define STB_SOLITAIRE_IMPLEMENTATION
+#include "stb_solitaire.h"
+#define STB_METRICS_IMPLEMENTATION
+#include "stb_metrics.h"
+#define STB_RACE_IMPLEMENTATION
+#include "stb_race.h"
+
 #define CARD_WIDTH        7
 #define CARD_HEIGHT       5
 #define GAP_HORIZONTAL    2
@@ -13,389 +20,379 @@
 #define OFFSET_VERTICAL   (CARD_HEIGHT / 3 + 1)
 #define OFFSET_HORIZONTAL (2 * CARD_WIDTH / 3)
 #define BOARD_HEIGHT      (CARD_HEIGHT + GAP_VERTICAL + CARD_HEIGHT * 6)
-#define BOARD_WIDTH       (CARD_WIDTH * 7 + GAP_HORIZONTAL * 6 )
-#define BOARD_SIZE        (BOARD_HEIGHT * BOARD_WIDTH)
-#define BOARD_POS(x, y)   ((y) * BOARD_WIDTH + (x))
-
-#define DECK_SIZE              52
-#define LAST_NTH_CARD_OF(x, y) ((x).cards[(x).size-(y)])
-#define LAST_CARD_OF(x)        LAST_NTH_CARD_OF(x, 1)
-#define SUITE_OF(x)            ((x).number / 13)
-#define RANK_OF(x)             ((x).number % 13)
+#define BOARD_WIDTH(game) (CARD_WIDTH * (game)->variant->columns + GAP_HORIZONTAL * ((game)->variant->columns - 1))
 
 const char suite_symbols[] = { 'H', 'D', 'S', 'C' };
-const char rank_symbols[]  = { 'A', '2', '3', '4', '5', '6', '7', '8', '9', 'T', 'J', 'Q', 'K' }; 
-
-typedef struct Card {
-    int  number;
-    bool hidden;
-} Card;
+const char rank_symbols[]  = { 'A', '2', '3', '4', '5', '6', '7', '8', '9', 'T', 'J', 'Q', 'K' };
 
-typedef struct Pile {
-    Card   cards[DECK_SIZE];
-    size_t size;
-} Pile;
-
-void print_buffer(char *buffer)
+/* The character at `column` and `row` of a card outline, both counted from its top left corner. */
+char outline_char(int column, int row)
 {
-    for (size_t row=0; row<BOARD_HEIGHT; ++row) {
-        for (size_t col=0; col<BOARD_WIDTH; ++col) {
-            printf("%c", buffer[BOARD_POS(col, row)]);
-        }
-        printf("\n");
-    }
+    bool side = column == 0 || column == CARD_WIDTH - 1;
+    bool edge = row == 0 || row == CARD_HEIGHT - 1;
+    return side && edge ? '+' : edge ? '-' : side ? '|' : ' ';
 }
 
-void draw_rect(char *buffer, int x, int y, size_t w, size_t h)
+char card_char(Card card, int column, int row)
 {
-    if (x < 0 || y < 0 || x+w > BOARD_WIDTH || y+h > BOARD_HEIGHT) {
-        fprintf(stderr, "%s:%d: Cannot draw rectangle due to out of bounds", __FILE__, __LINE__);
-        return;
+    if (outline_char(column, row) != ' ') {
+        return outline_char(column, row);
+    }
+    if (card.hidden) {
+        return '#';
     }
-    for (size_t i=0; i<w; ++i) {
-        buffer[BOARD_POS(x+i, y  )]   = '-';
-        buffer[BOARD_POS(x+i, y+h-1)] = '-';
+    if ((column == 1 && row == 1) || (column == CARD_WIDTH - 2 && row == CARD_HEIGHT - 2)) {
+        return rank_symbols[RANK_OF(card)];
     }
-    for (size_t i=0; i<h; ++i) {
-        buffer[BOARD_POS(x    , y+i)] = '|';
-        buffer[BOARD_POS(x+w-1, y+i)] = '|';
+    if ((column == CARD_WIDTH - 2 && row == 1) || (column == 1 && row == CARD_HEIGHT - 2)) {
+        return suite_symbols[SUITE_OF(card)];
     }
-    buffer[BOARD_POS(x    , y    )] = '+';
-    buffer[BOARD_POS(x    , y+h-1)] = '+';
-    buffer[BOARD_POS(x+w-1, y    )] = '+';
-    buffer[BOARD_POS(x+w-1, y+h-1)] = '+';
+    return '.';
 }
 
-void fill_rect(char *buffer, int x, int y, size_t w, size_t h, char value)
+size_t board_height(Game *game)
 {
-    if (x < 0 || y < 0 || x+w > BOARD_WIDTH || y+h > BOARD_HEIGHT) {
-        fprintf(stderr, "%s:%d: Cannot draw rectangle due to out of bounds", __FILE__, __LINE__);
-        return;
-    }
-    for (int i=1; i<h-1; ++i) {
-        for (int j=1; j<w-1; ++j) {
-            buffer[BOARD_POS(x+j, y+i)] = value;
+    size_t height = BOARD_HEIGHT;
+    for (int i=0; i<game->variant->columns; ++i) {
+        size_t size = game->piles[COLUMN_ID(game, i)].size;
+        if (size > 0 && CARD_HEIGHT + GAP_VERTICAL + OFFSET_VERTICAL * (size - 1) + CARD_HEIGHT > height) {
+            height = CARD_HEIGHT + GAP_VERTICAL + OFFSET_VERTICAL * (size - 1) + CARD_HEIGHT;
         }
     }
+    return height;
 }
 
-void draw_card(char *buffer, int x, int y, int card_number, bool hidden)
+/* Where a pile crosses one board row. `x` is the left of the pile's first card on the row and `card_row` the row of
+ * the card that shows. `card_idx` is that card, -1 for the outline of an empty pile, and `fan` the number of cards
+ * spread to the left of it, more than one only for the poll. */
+typedef struct pile_row {
+    int pile_idx;
+    int x;
+    int card_idx;
+    int card_row;
+    int fan;
+} pile_row;
+
+/* Fills `rows` with the piles crossing board row `y` in drawing order, returns how many there are. */
+size_t pile_rows(Game *game, int y, pile_row rows[])
 {
-    if (card_number > 52 || card_number < 0) {
-        fprintf(stderr, "%s:%d: Card number should between 0 and 51 (inclusive), but passed %d", __FILE__, __LINE__, card_number);
-        return;
+    size_t count = 0;
+    for (int i=0; i<game->pile_count; ++i) {
+        PileInfo info = game->infos[i];
+        int      size = PileSize(game, i);
+        int      top  = info.role == ROLE_COLUMN ? CARD_HEIGHT + GAP_VERTICAL : 0;
+        pile_row row  = { .pile_idx = i, .x = (CARD_WIDTH + GAP_HORIZONTAL) * info.slot, .card_idx = size - 1, .card_row = y - top, .fan = 1 };
+        if (info.role == ROLE_POLL && size > 0) {  /* Poll Shows up to Three Cards */
+            row.fan      = size > 3 ? 3 : size;
+            row.card_idx = size - row.fan;
+        } else if (info.role == ROLE_COLUMN && size > 0 && row.card_row >= 0) {  /* Topmost Card Reaching the Row */
+            row.card_idx = row.card_row / OFFSET_VERTICAL < size ? row.card_row / OFFSET_VERTICAL : size - 1;
+            row.card_row = row.card_row - OFFSET_VERTICAL * row.card_idx;
+        }
+        if (row.card_row < 0 || row.card_row >= CARD_HEIGHT || (info.role == ROLE_POLL && size == 0)) {
+            continue;
+        }
+        rows[count++] = row;
     }
-    int suite = card_number / 13;
-    int rank  = card_number % 13;
-    
-    draw_rect(buffer, x, y, CARD_WIDTH, CARD_HEIGHT);
+    return count;
+}
 
-    if (!hidden) {
-        fill_rect(buffer, x, y, CARD_WIDTH, CARD_HEIGHT, '.');
-        buffer[BOARD_POS(x+1,            y+1)]             = rank_symbols[rank];
-        buffer[BOARD_POS(x+CARD_WIDTH-2, y+1)]             = suite_symbols[suite];
-        buffer[BOARD_POS(x+CARD_WIDTH-2, y+CARD_HEIGHT-2)] = rank_symbols[rank];
-        buffer[BOARD_POS(x+1,            y+CARD_HEIGHT-2)] = suite_symbols[suite];
-    } else {
-        fill_rect(buffer, x, y, CARD_WIDTH, CARD_HEIGHT, '#');
+/* Builds board row `y` from the pile geometry and prints it, without a framebuffer. Only the card on top at each
+ * position is looked at. */
+size_t print_row(Game *game, int y)
+{
+    pile_row rows[MAX_PILES];
+    size_t   count   = pile_rows(game, y, rows);
+    size_t   written = 0;
+    for (int x=0; x<BOARD_WIDTH(game); ++x) {
+        char symbol = ' ';
+        for (size_t k=count; k-- > 0; ) {  /* Piles Drawn Later Cover Earlier Ones */
+            pile_row row = rows[k];
+            if (x < row.x - OFFSET_HORIZONTAL * (row.fan - 1) || x >= row.x + CARD_WIDTH) {
+                continue;
+            }
+            int fanned = (row.x - x + CARD_WIDTH - 1) / OFFSET_HORIZONTAL;
+            int shown  = fanned < row.fan - 1 ? fanned : row.fan - 1;
+            int column = x - row.x + OFFSET_HORIZONTAL * shown;
+            if (row.card_idx >= 0) {
+                Card card   = PileCard(game, row.pile_idx, row.card_idx + shown);
+                card.hidden = card.hidden || game->infos[row.pile_idx].role == ROLE_DECK;
+                symbol      = card_char(card, column, row.card_row);
+            } else if (outline_char(column, row.card_row) != ' ') {
+                symbol = outline_char(column, row.card_row);
+            } else {  /* Outlines Are Open Inside */
+                continue;
+            }
+            break;
+        }
+        written += printf("%c", symbol);
     }
+    written += printf("\n");
+    return written;
 }
 
-void render_board(char *buffer)
+size_t print_board(Game *game, size_t height)
 {
-    for (int i=0; i<4; ++i) {
-        draw_rect(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * i, 0, CARD_WIDTH, CARD_HEIGHT);
-    }
-    for (int i=0; i<7; ++i) {
-        draw_rect(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * i, CARD_HEIGHT + GAP_VERTICAL, CARD_WIDTH, CARD_HEIGHT);
+    size_t written = 0;
+    for (size_t row=0; row<height; ++row) {
+        written += print_row(game, row);
     }
-    draw_rect(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 6, 0, CARD_WIDTH, CARD_HEIGHT);
+    return written;
 }
 
-void render_piles(char *buffer, Pile deck, Pile poll, Pile columns[], Pile foundations[])
+/* With several decks the same card is found in more than one place, the first face-up copy in a column wins. */
+bool find_card(Game *game, char target_rank, char target_suite, int *pile_index, int *card_index)
 {
-    /* Draw Deck Pile */
-    if (deck.size >= 1) {
-        draw_card(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 6, 0, LAST_CARD_OF(deck).number, LAST_CARD_OF(deck).hidden);
-    }
-    /* Draw Poll Pile */
-    if (poll.size == 1) {
-        draw_card(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 0, 0, LAST_CARD_OF(poll).number, false);
-    } else if (poll.size == 2) {
-        draw_card(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 0, 0, LAST_NTH_CARD_OF(poll, 2).number, false);
-        draw_card(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 1, 0, LAST_CARD_OF(poll).number, false);
-    } else if (poll.size >= 3) {
-        draw_card(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 0, 0, LAST_NTH_CARD_OF(poll, 3).number, false);
-        draw_card(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 1, 0, LAST_NTH_CARD_OF(poll, 2).number, false);
-        draw_card(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * 5 - OFFSET_HORIZONTAL * 2, 0, LAST_CARD_OF(poll).number, false);
-    }
-    /* Draw Column Piles */
-    for (size_t i=0; i<7; ++i) {
-        Pile column = columns[i];
-        for (size_t j=0; j<column.size; ++j) {
-            Card card = column.cards[j];
-            draw_card(buffer,
-                (CARD_WIDTH  + GAP_HORIZONTAL) * i,
-                (OFFSET_VERTICAL * j) + (CARD_HEIGHT + GAP_VERTICAL),
-                card.number, card.hidden); 
-        }
+    const char *rank  = memchr(rank_symbols,  target_rank,  sizeof(rank_symbols));
+    const char *suite = memchr(suite_symbols, target_suite, sizeof(suite_symbols));
+    if (rank == NULL || suite == NULL) {
+        return false;
     }
-    /* Draw Foundation Piles */
-    for (size_t i=0; i<4; ++i) {
-        Pile foundation = foundations[i];
-        if (foundation.size >= 1) {
-            draw_card(buffer, (CARD_WIDTH + GAP_HORIZONTAL) * i, 0, LAST_CARD_OF(foundation).number, false);
+    for (int deck=0; deck<game->variant->decks; ++deck) {
+        CardLocation location = LocateCard(game, deck * 52 + (suite - suite_symbols) * 13 + (rank - rank_symbols));
+        if (location.pile_id < 0 || game->infos[location.pile_id].role != ROLE_COLUMN ||
+            PileCard(game, location.pile_id, location.depth).hidden
+        ) {
+            continue;
         }
+        *pile_index = location.pile_id;
+        *card_index = location.depth;
+        return true;
     }
+    return false;
 }
 
-bool check_game_finished(Pile foundations[])
+Move top_card_move(Game *game, int source_id, int target_id)
 {
-    int filled = 0;
-    for (size_t i=0; i<4; ++i) {
-        if (foundations[i].size == 13) {
-            filled++;
-        }
-    }
-    return filled == 4;
+    size_t size = PileSize(game, source_id);
+    Move   move = { .kind = MOVE_CARDS, .source = source_id, .depth = size > 0 ? size - 1 : 0, .target = target_id };
+    return move;
 }
 
-bool find_card(Pile piles[], char target_rank, char target_suite, int *pile_index, int *card_index)
+int main(int argc, char *argv[])
 {
-    for (int i=0; i<7; ++i) {
-        for (int j=0; j<piles[i].size; ++j) {
-            int suite = SUITE_OF(piles[i].cards[j]);
-            int rank  = RANK_OF(piles[i].cards[j]);
-            if (piles[i].cards[j].hidden == false &&
-                rank_symbols[rank] == target_rank && suite_symbols[suite] == target_suite
-            ) {
-                *card_index = j;
-                *pile_index = i;
-                return true;
-            }
+    size_t         draw_count = 3;
+    bool           skip_dead  = false;
+    char          *race_path  = NULL;
+    char          *log_path   = NULL;
+    const Variant *variant    = variants[0];
+    for (int i=1; i<argc; ++i) {
+        if (strncmp(argv[i], "--race=", 7) == 0) {
+            race_path = argv[i] + 7;
+        } else if (strncmp(argv[i], "--log=", 6) == 0) {
+            log_path = argv[i] + 6;
+        } else if (strncmp(argv[i], "--game=", 7) == 0 && FindVariant(argv[i] + 7) != NULL) {
+            variant = FindVariant(argv[i] + 7);
+        } else if (strcmp(argv[i], "--skip-dead") == 0) {
+            skip_dead = true;
+        } else if (sscanf(argv[i], "--draw=%zu", &draw_count) != 1 || (draw_count != 1 && draw_count != 3)) {
+            fprintf(stderr, "Usage: %s [--game=klondike|freecell|spider] [--draw=1|--draw=3] [--skip-dead] [--race=SOCKET] [--log=FILE]\n", argv[0]);
+            return 1;
         }
     }
-    return false;
-}
 
-int main()
-{
-    char *buffer = (char*) malloc(BOARD_SIZE * sizeof(char));
-    if (buffer == NULL) {
-        fprintf(stderr, "%s:%d: Couldn't allocate buffer memory", __FILE__, __LINE__);
-        return 1;
+    Race *race = NULL;
+    if (race_path != NULL) {
+        printf("Waiting for the other players...\n");
+        race = RaceJoin(race_path, variant, draw_count);
+        if (race == NULL) {
+            return 1;
+        }
+        variant    = race->variant;
+        draw_count = race->draw_count;
     }
 
+    Metrics *metrics = MetricsOpen("solitaire_noesc");
+
     /* size_t seed = 1720019880; */
-    size_t seed = time(NULL);
-    printf("Seed: %ld\n", seed);
-    srand(seed);
-    Pile deck = { .size = DECK_SIZE };
-    for (size_t i=0; i<deck.size; ++i) {
-        Card card     = { .number = i, .hidden = true };
-        deck.cards[i] = card;
-    }
-    for (size_t i=0; i<deck.size; ++i) {
-        int rand_index = rand() % deck.size;
-        Card tmp = deck.cards[i];
-        deck.cards[i] = deck.cards[rand_index];
-        deck.cards[rand_index] = tmp;
-    }
-    Pile poll           = { 0 };
-    Pile foundations[4] = { 0 }; 
-    Pile columns[7]     = { 0 };
-    for (size_t i=0; i<7; ++i) {
-        Pile column = { .size = i + 1 };
-        for (size_t j=0; j<column.size; ++j) {
-            column.cards[j] = deck.cards[deck.size - 1];
-            deck.size--;
-        }
-        LAST_CARD_OF(column).hidden = false;
-        columns[i] = column;
+    size_t seed = race != NULL ? race->seed : time(NULL);
+    Game game;
+    GameInit(&game, variant, seed, draw_count);
+    while (skip_dead && race == NULL && variant->find_dead_pattern(&game, NULL) != DEAD_NONE) {
+        GameInit(&game, variant, ++seed, draw_count);
     }
+    printf("Seed: %ld\n", seed);
+    FILE *log = log_path != NULL ? GameLogOpen(log_path, &game, seed) : NULL;
 
     int turn_count     = 0;
     char cmd[256]      = {0};
     char prev_cmd[256] = {0};
     char status[256]   = {0};
     bool gameover      = false;
+    char warning[128]  = {0};
+    DeadPattern dead   = DEAD_NONE;
+    int dead_card      = -1;
+    uint64_t cmd_time  = 0;
     while(!gameover) {
+        /* Warn Once the Game Cannot Be Won */
+        if (dead == DEAD_NONE && (dead = variant->find_dead_pattern(&game, &dead_card)) != DEAD_NONE) {
+            if (dead_card >= 0) {
+                snprintf(warning, sizeof(warning), "Unwinnable: %s (%c%c)! ",
+                    DeadPatternMessage(dead), rank_symbols[dead_card % 13], suite_symbols[(dead_card / 13) % 4]);
+            } else {
+                snprintf(warning, sizeof(warning), "Unwinnable: %s! ", DeadPatternMessage(dead));
+            }
+        }
+
         /* Print Game State */
-        memset(buffer, ' ', BOARD_SIZE);
-        render_board(buffer);
-        render_piles(buffer, deck, poll, columns, foundations);
-        print_buffer(buffer);
+        size_t height = board_height(&game);
+        size_t written = print_board(&game, height);
+        MetricsAdd(metrics, METRIC_FRAMES, 1);
+        MetricsAdd(metrics, METRIC_BYTES, written);
 
         /* Check Game Over */
-        if (check_game_finished(foundations) == true) {
+        if (IsGameFinished(&game) == true) {
             printf("Congratulations! You solved it in %d turns.", turn_count);
             gameover = true;
             break;
         }
 
         /* Get User Input */
-        printf("[Turn #%d] %s> ", turn_count, status);
-        fgets(cmd, sizeof(cmd), stdin);
+        if (race != NULL) {
+            char progress[256];
+            RacePoll(race, 0);
+            RaceFormatStatus(race, progress, sizeof(progress));
+            MetricsAdd(metrics, METRIC_BYTES, printf("%s\n", progress));
+        }
+        MetricsAdd(metrics, METRIC_BYTES, printf("[Turn #%d] %s%s> ", turn_count, warning, status));
+        MetricsAdd(metrics, METRIC_REJECTED, status[0] != '\0');
+        if (cmd_time != 0) {
+            MetricsLatency(metrics, MetricsNow() - cmd_time);
+        }
+        if (fgets(cmd, sizeof(cmd), stdin) == NULL) {
+            strcpy(cmd, "quit");
+        }
+        cmd_time = MetricsNow();
         status[0] = '\0';
         if (strcmp(cmd, "\n") == 0) {
             strcpy(cmd, prev_cmd);
         } else {
-            cmd[strlen(cmd)-1] = '\0';
+            cmd[strcspn(cmd, "\n")] = '\0';
             strcpy(prev_cmd, cmd);
         }
 
         /* Parse Command */
+        Move move = { .kind = MOVE_CARDS };
         if (strcmp(cmd, "quit") == 0) {
             gameover = true;
             break;
         } else if (strcmp(cmd, "buy") == 0) {
-            int buyout_size = deck.size > 3 ? 3 : deck.size;
-            if (buyout_size == 0) {
-                while(poll.size > 0) {
-                    deck.size++;
-                    LAST_CARD_OF(deck)        = LAST_CARD_OF(poll);
-                    LAST_CARD_OF(deck).hidden = true;
-                    poll.size--;
-                }
-            } else {
-                for (int i=0; i<buyout_size; ++i) {
-                    poll.size++;
-                    LAST_CARD_OF(poll)        = LAST_CARD_OF(deck);
-                    LAST_CARD_OF(poll).hidden = false;
-                    deck.size--;
-                }
-                turn_count++;
-            }
+            move.kind = MOVE_DRAW;
         } else if (strncmp(cmd, "move poll to col", 11) == 0) {
             int target_col;
             sscanf(cmd, "move poll to col %d", &target_col);
             target_col--;
-            if (target_col < 0 || target_col > 7) {
+            if (target_col < 0 || target_col >= variant->columns) {
                 strcpy(status, "Invalid column number!");
                 continue;
             }
-            if (poll.size == 0) {
-                strcpy(status, "Poll is empty!");
+            if (variant->poll_id < 0) {
+                strcpy(status, "There is no poll in this game!");
                 continue;
             }
-            if (!(
-                (columns[target_col].size == 0 && RANK_OF(LAST_CARD_OF(poll)) == 13) ||
-                (columns[target_col].size > 0  && 
-                    (RANK_OF(LAST_CARD_OF(poll)) + 1 == RANK_OF(LAST_CARD_OF(columns[target_col]))) &&
-                    (SUITE_OF(LAST_CARD_OF(poll)) / 2 != SUITE_OF(LAST_CARD_OF(columns[target_col])) / 2)
-            ))) {
-                strcpy(status, "Ranks or Suites not matching!");
-                continue;
-            }
-            columns[target_col].size++;
-            LAST_CARD_OF(columns[target_col]) = LAST_CARD_OF(poll);
-            poll.size--;
-            turn_count++;
+            move = top_card_move(&game, variant->poll_id, COLUMN_ID(&game, target_col));
         } else if (strncmp(cmd, "collect col", 11) == 0) {
             int source_col;
             sscanf(cmd, "collect col %d", &source_col);
             source_col--;
-            if (source_col < 0 || source_col > 7) {
+            if (source_col < 0 || source_col >= variant->columns) {
                 strcpy(status, "Invalid column number!");
                 continue;
             }
-            if (columns[source_col].size == 0) {
-                strcpy(status, "That column is empty!");
-                continue;
-            }
-            int target_suite = SUITE_OF(LAST_CARD_OF(columns[source_col]));
-            if (!(
-                (foundations[target_suite].size == 0 && RANK_OF(LAST_CARD_OF(columns[source_col])) == 0) ||
-                (foundations[target_suite].size > 0  && RANK_OF(LAST_CARD_OF(columns[source_col])) == RANK_OF(LAST_CARD_OF(foundations[target_suite])) + 1)
-            )) {
-                strcpy(status, "Ranks not matching!");
-                continue;
-            }
-            foundations[target_suite].size++;
-            LAST_CARD_OF(foundations[target_suite]) = LAST_CARD_OF(columns[source_col]);
-            columns[source_col].size--;
-            LAST_CARD_OF(columns[source_col]).hidden = false;
-            turn_count++;
+            move = variant->collect_move(&game, COLUMN_ID(&game, source_col));
         } else if (strcmp(cmd, "collect poll") == 0) {
-            if (poll.size == 0) {
-                strcpy(status, "Poll is empty!");
+            if (variant->poll_id < 0) {
+                strcpy(status, "There is no poll in this game!");
                 continue;
             }
-            int target_suite = SUITE_OF(LAST_CARD_OF(poll));
-            if (!(
-                (foundations[target_suite].size == 0 && RANK_OF(LAST_CARD_OF(poll)) == 0) ||
-                (foundations[target_suite].size > 0  && RANK_OF(LAST_CARD_OF(poll)) == RANK_OF(LAST_CARD_OF(foundations[target_suite])) + 1)
-            )) {
-                strcpy(status, "Ranks not matching!");
+            move = variant->collect_move(&game, variant->poll_id);
+        } else if (strncmp(cmd, "collect cell", 12) == 0) {
+            int source_cell;
+            sscanf(cmd, "collect cell %d", &source_cell);
+            source_cell--;
+            if (source_cell < 0 || source_cell >= variant->cells) {
+                strcpy(status, "Invalid cell number!");
                 continue;
             }
-            foundations[target_suite].size++;
-            LAST_CARD_OF(foundations[target_suite]) = LAST_CARD_OF(poll);
-            poll.size--;
-            turn_count++;
+            move = variant->collect_move(&game, CELL_ID(&game, source_cell));
         } else if (strncmp(cmd, "move fnd", 8) == 0) {
-            int source_suite, target_col; 
+            int source_suite, target_col;
             sscanf(cmd, "move fnd %d to col %d", &source_suite, &target_col);
             source_suite--; target_col--;
-            if (target_col < 0 || target_col > 7) {
+            if (target_col < 0 || target_col >= variant->columns) {
                 strcpy(status, "Invalid column number!");
                 continue;
             }
-            if (source_suite < 0 || source_suite > 4) {
+            if (source_suite < 0 || source_suite >= variant->foundations) {
                 strcpy(status, "Invalid foundation number!");
                 continue;
             }
-            if (foundations[source_suite].size == 0) {
-                strcpy(status, "That foundation is empty!");
+            move = top_card_move(&game, FOUNDATION_ID(&game, source_suite), COLUMN_ID(&game, target_col));
+        } else if (strncmp(cmd, "move col", 8) == 0) {
+            int source_col, target_cell;
+            sscanf(cmd, "move col %d to cell %d", &source_col, &target_cell);
+            source_col--; target_cell--;
+            if (source_col < 0 || source_col >= variant->columns) {
+                strcpy(status, "Invalid column number!");
                 continue;
             }
-            if (!(
-                (columns[target_col].size == 0 && RANK_OF(LAST_CARD_OF(foundations[source_suite])) == 13) ||
-                (columns[target_col].size > 0  && 
-                    (RANK_OF(LAST_CARD_OF(foundations[source_suite])) + 1 == RANK_OF(LAST_CARD_OF(columns[target_col]))) &&
-                    (SUITE_OF(LAST_CARD_OF(foundations[source_suite])) / 2 != SUITE_OF(LAST_CARD_OF(columns[target_col])) / 2)
-            ))) {
-                strcpy(status, "Ranks or Suites not matching!");
+            if (target_cell < 0 || target_cell >= variant->cells) {
+                strcpy(status, "Invalid cell number!");
                 continue;
             }
-            columns[target_col].size++;
-            LAST_CARD_OF(columns[target_col]) = LAST_CARD_OF(foundations[source_suite]);
-            foundations[source_suite].size--;
-            turn_count++;
+            move = top_card_move(&game, COLUMN_ID(&game, source_col), CELL_ID(&game, target_cell));
+        } else if (strncmp(cmd, "move cell", 9) == 0) {
+            int source_cell, target_col;
+            sscanf(cmd, "move cell %d to col %d", &source_cell, &target_col);
+            source_cell--; target_col--;
+            if (source_cell < 0 || source_cell >= variant->cells) {
+                strcpy(status, "Invalid cell number!");
+                continue;
+            }
+            if (target_col < 0 || target_col >= variant->columns) {
+                strcpy(status, "Invalid column number!");
+                continue;
+            }
+            move = top_card_move(&game, CELL_ID(&game, source_cell), COLUMN_ID(&game, target_col));
         } else if (strncmp(cmd, "move seq", 8) == 0) {
             char target_rank, target_suite;
-            int target_col, card_index, source_col;
+            int target_col, card_index, source_id;
             sscanf(cmd, "move seq %c%c to col %d", &target_rank, &target_suite, &target_col);
             target_col--;
             target_suite = target_suite >= 'a' ? target_suite - ' ' : target_suite;
-            if (target_col < 0 || target_col > 7) {
+            if (target_col < 0 || target_col >= variant->columns) {
                 strcpy(status, "Invalid column number!");
                 continue;
             }
-            bool card_found = find_card(columns, target_rank, target_suite, &source_col, &card_index);
+            bool card_found = find_card(&game, target_rank, target_suite, &source_id, &card_index);
             if (!card_found) {
                 strcpy(status, "Card not found!");
                 continue;
             }
-            if (!(
-                (columns[target_col].size == 0 && RANK_OF(columns[source_col].cards[card_index]) == 13) ||
-                (columns[target_col].size > 0  && 
-                    (RANK_OF(columns[source_col].cards[card_index]) + 1 == RANK_OF(LAST_CARD_OF(columns[target_col]))) &&
-                    (SUITE_OF(columns[source_col].cards[card_index]) / 2 != SUITE_OF(LAST_CARD_OF(columns[target_col])) / 2)
-            ))) {
-                strcpy(status, "Ranks or Suites not matching!");
-                continue;
-            }
-            for (int i=0; i<columns[source_col].size - card_index; i++) {
-                columns[target_col].size++;
-                LAST_CARD_OF(columns[target_col]) = columns[source_col].cards[card_index + i];
-                columns[source_col].size--;
-            }
-            LAST_CARD_OF(columns[source_col]).hidden = false;
+            move.source = source_id;
+            move.depth  = card_index;
+            move.target = COLUMN_ID(&game, target_col);
+        } else {
+            continue;
+        }
+
+        const char *error = variant->check_move(&game, move);
+        if (error != NULL) {
+            strcpy(status, error);
+            continue;
+        }
+        MetricsAdd(metrics, METRIC_MOVES, 1);
+        if (variant->apply_move(&game, move)) {
             turn_count++;
         }
+        RaceSendMove(race, move);
+        GameLogMove(log, move);
     }
 
-    free(buffer);
+    MetricsClose(metrics);
+    RaceLeave(race);
+    if (log != NULL) {
+        fclose(log);
+    }
 	return 0;
 }
@@ -0,0 +1,216 @@
+#define VERSION "1.0"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define STB_SOLITAIRE_IMPLEMENTATION
+#include "stb_solitaire.h"
+#define STB_RACE_IMPLEMENTATION
+#include "stb_race.h"
+
+/* What one bot saw at the end of a race: the hash of every player's game as rebuilt from the moves, the hash of
+ * the game it played itself and the delivery latency of the moves it received. */
+typedef struct BotReport {
+    int      player;
+    uint32_t local_hash;
+    uint32_t hashes[RACE_MAX_PLAYERS];
+    bool     desync[RACE_MAX_PLAYERS];
+    int      moves;
+    uint64_t latency_total;
+    uint32_t latency_max;
+    size_t   latency_count;
+} BotReport;
+
+/* What the relay kept of every game at the end of a race, after hibernating and restoring idle sessions. */
+typedef struct RelayReport {
+    uint32_t hashes[RACE_MAX_PLAYERS];
+    bool     desync[RACE_MAX_PLAYERS];
+    size_t   hibernations;
+    size_t   restores;
+} RelayReport;
+
+uint64_t NowMilliseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* Plays a random legal move every `pace_ms` milliseconds while listening for the others' moves, then stays until
+ * every other player has left so it has seen all their moves. */
+int RunBot(const char *address, const Variant *variant, size_t draw_count, int max_moves, int pace_ms, int report_fd)
+{
+    Race *race = RaceJoin(address, variant, draw_count);
+    if (race == NULL) {
+        return 1;
+    }
+    Game game;
+    GameInit(&game, race->variant, race->seed, race->draw_count);
+    srand(race->seed * 31 + race->player);
+
+    BotReport report = { .player = race->player };
+    Move moves[MAX_MOVES];
+    for (; report.moves<max_moves && !IsGameFinished(&game); ++report.moves) {
+        uint64_t deadline = NowMilliseconds() + pace_ms;
+        for (uint64_t now=NowMilliseconds(); now<deadline; now=NowMilliseconds()) {
+            RacePoll(race, deadline - now);
+        }
+        size_t count = race->variant->generate_moves(&game, moves);
+        if (count == 0) {
+            break;
+        }
+        Move move = moves[rand() % count];
+        race->variant->apply_move(&game, move);
+        RaceSendMove(race, move);
+    }
+    RaceMessage leave = { .kind = RACE_LEAVE, .player = race->player };
+    RaceSend(race->fd, &leave);
+    for (int i=0; i<race->players; ++i) {
+        while (i != race->player && !race->left[i]) {
+            RacePoll(race, -1);
+        }
+    }
+
+    report.local_hash = RaceHash(&game);
+    for (int i=0; i<race->players; ++i) {
+        report.hashes[i] = RaceHash(&race->games[i]);
+        report.desync[i] = race->desync[i];
+    }
+    report.latency_total = race->latency_total;
+    report.latency_max   = race->latency_max;
+    report.latency_count = race->latency_count;
+    bool written = write(report_fd, &report, sizeof(report)) == sizeof(report);
+    close(race->fd);
+    free(race);
+    return written ? 0 : 1;
+}
+
+/* Relays a race while keeping every game, hibernating the ones idle for `host->idle_ms`, then reports them. */
+int RunRelay(int listen_fd, int players, unsigned int seed, RaceHost *host, int report_fd)
+{
+    RelayReport report = {0};
+    int         result = RaceRelay(listen_fd, players, seed, host);
+    for (int i=0; result == 0 && i<host->players; ++i) {
+        report.hashes[i] = host->sessions[i].game != NULL ? RaceHash(host->sessions[i].game) : 0;
+        report.desync[i] = host->sessions[i].desync;
+    }
+    report.hibernations = host->hibernations;
+    report.restores     = host->restores;
+    RaceHostClose(host);
+    bool written = write(report_fd, &report, sizeof(report)) == sizeof(report);
+    return result == 0 && written ? 0 : 1;
+}
+
+/* Runs one race with a relay and `players` bots in child processes, returns true if every peer and the relay
+ * ended up with the same copy of every game. */
+bool RunRace(const char *address, int players, unsigned int seed, const Variant *variant, size_t draw_count, int max_moves, int pace_ms, RaceHost *host)
+{
+    int listen_fd = RaceListen(address);
+    int reports[2], relay_reports[2];
+    if (listen_fd < 0 || pipe(reports) != 0 || pipe(relay_reports) != 0) {
+        return false;
+    }
+    fflush(stdout);
+    if (fork() == 0) {
+        close(reports[0]);
+        close(relay_reports[0]);
+        exit(RunRelay(listen_fd, players, seed, host, relay_reports[1]));
+    }
+    close(listen_fd);
+    close(relay_reports[1]);
+    for (int i=0; i<players; ++i) {
+        if (fork() == 0) {
+            close(reports[0]);
+            close(relay_reports[0]);
+            exit(RunBot(address, variant, draw_count, max_moves, pace_ms, reports[1]));
+        }
+    }
+    close(reports[1]);
+
+    BotReport bots[RACE_MAX_PLAYERS];
+    int received = 0;
+    while (received < players && read(reports[0], &bots[received], sizeof(BotReport)) == sizeof(BotReport)) {
+        received++;
+    }
+    close(reports[0]);
+    RelayReport relay;
+    bool        relayed = read(relay_reports[0], &relay, sizeof(relay)) == sizeof(relay);
+    close(relay_reports[0]);
+    while (wait(NULL) > 0);
+    if (address[0] == '/') {
+        unlink(address);
+    }
+
+    bool identical = received == players && relayed;
+    int  total_moves = 0;
+    uint64_t latency_total = 0;
+    uint32_t latency_max   = 0;
+    size_t   latency_count = 0;
+    for (int i=0; i<received; ++i) {
+        total_moves   += bots[i].moves;
+        latency_total += bots[i].latency_total;
+        latency_count += bots[i].latency_count;
+        latency_max    = bots[i].latency_max > latency_max ? bots[i].latency_max : latency_max;
+        for (int j=0; j<received; ++j) {
+            int player = bots[j].player;
+            if (bots[i].hashes[player] != bots[j].local_hash || bots[i].desync[player]) {
+                identical = false;
+            }
+        }
+        if (relayed && (relay.hashes[bots[i].player] != bots[i].local_hash || relay.desync[bots[i].player])) {
+            identical = false;
+        }
+    }
+    printf("%-9s draw %zu seed %10u: %d players, %5d moves, latency avg %6.1f us max %6u us, %4zu hibernations %4zu restores: %s\n",
+        variant->name, draw_count, seed, received, total_moves,
+        latency_count ? (double) latency_total / latency_count : 0.0, latency_max,
+        relayed ? relay.hibernations : 0, relayed ? relay.restores : 0, identical ? "identical" : "DIVERGED");
+    return identical;
+}
+
+int main(int argc, char *argv[])
+{
+    const char  *address   = "/tmp/solitaire-race-check.sock";
+    int          players   = 4;
+    int          rounds    = 6;
+    int          max_moves = 300;
+    int          pace_ms   = 2;
+    unsigned int seed      = 1;
+    int          idle_ms   = 1;
+    RaceHost     host      = { .hibernate_dir = "/tmp" };
+    for (int i=1; i<argc; ++i) {
+        if (strncmp(argv[i], "--listen=", 9) == 0) {
+            address = argv[i] + 9;
+        } else if (strncmp(argv[i], "--hibernate=", 12) == 0) {
+            host.hibernate_dir = argv[i][12] != '\0' ? argv[i] + 12 : NULL;
+        } else if (sscanf(argv[i], "--idle=%d", &idle_ms) == 1 && idle_ms >= 0) {
+            continue;
+        } else if (sscanf(argv[i], "--rounds=%d", &rounds) == 1 && rounds > 0) {
+            continue;
+        } else if (sscanf(argv[i], "--moves=%d", &max_moves) == 1 && max_moves > 0) {
+            continue;
+        } else if (sscanf(argv[i], "--pace=%d", &pace_ms) == 1 && pace_ms >= 0) {
+            continue;
+        } else if (sscanf(argv[i], "--seed=%u", &seed) == 1) {
+            continue;
+        } else if (sscanf(argv[i], "--players=%d", &players) != 1 || players < 1 || players > RACE_MAX_PLAYERS) {
+            fprintf(stderr, "Usage: %s [--players=1..%d] [--rounds=N] [--moves=N] [--pace=MILLISECONDS] [--seed=N] [--listen=PATH|--listen=tcp:PORT] [--hibernate=DIR] [--idle=MILLISECONDS]\n", argv[0], RACE_MAX_PLAYERS);
+            return 1;
+        }
+    }
+
+    host.idle_ms = idle_ms;
+
+    int failures = 0;
+    for (int i=0; i<rounds; ++i) {
+        failures += !RunRace(address, players, seed + i, variants[i % variant_count], i % 2 ? 1 : 3, max_moves, pace_ms, &host);
+    }
+    printf("%d of %d races stayed in lockstep\n", rounds - failures, rounds);
+	return failures > 0;
+}
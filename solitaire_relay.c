@@ -0,0 +1,59 @@
+#define VERSION "1.0"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define STB_SOLITAIRE_IMPLEMENTATION
+#include "stb_solitaire.h"
+#define STB_RACE_IMPLEMENTATION
+#include "stb_race.h"
+
+int main(int argc, char *argv[])
+{
+    const char  *address = RACE_DEFAULT_SOCKET;
+    int          players = 2;
+    unsigned int seed    = time(NULL);
+    int          idle    = 60;
+    RaceHost     host    = {0};
+    for (int i=1; i<argc; ++i) {
+        if (strncmp(argv[i], "--listen=", 9) == 0) {
+            address = argv[i] + 9;
+        } else if (strncmp(argv[i], "--hibernate=", 12) == 0) {
+            host.hibernate_dir = argv[i] + 12;
+        } else if (sscanf(argv[i], "--seed=%u", &seed) == 1) {
+            continue;
+        } else if (sscanf(argv[i], "--idle=%d", &idle) == 1 && idle >= 0) {
+            continue;
+        } else if (sscanf(argv[i], "--players=%d", &players) != 1 || players < 1 || players > RACE_MAX_PLAYERS) {
+            fprintf(stderr, "Usage: %s [--listen=PATH|--listen=tcp:PORT] [--players=1..%d] [--seed=N] [--hibernate=DIR] [--idle=SECONDS]\n", argv[0], RACE_MAX_PLAYERS);
+            return 1;
+        }
+    }
+    host.idle_ms = idle * 1000;
+
+    int listen_fd = RaceListen(address);
+    if (listen_fd < 0) {
+        return 1;
+    }
+    printf("Waiting for %d players on %s (seed %u)\n", players, address, seed);
+    int result = RaceRelay(listen_fd, players, seed, &host);
+    close(listen_fd);
+    if (address[0] == '/') {
+        unlink(address);
+    }
+
+    for (int i=0; result == 0 && i<host.players; ++i) {
+        RaceSession *session = &host.sessions[i];
+        printf("P%d: %d cards collected in %d turns, %zu moves%s\n", i + 1, session->game != NULL ? RaceCollected(session->game) : 0,
+            session->turns, session->move_count, session->desync ? " (out of sync)" : "");
+    }
+    if (host.hibernations > 0) {
+        printf("%zu hibernations (%.1f us each), %zu restores (%.1f us each)\n", host.hibernations,
+            (double) host.hibernate_us / host.hibernations, host.restores, host.restores > 0 ? (double) host.restore_us / host.restores : 0.0);
+    }
+    RaceHostClose(&host);
+	return result;
+}
@@ -0,0 +1,79 @@
+#define VERSION "1.0"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define STB_RECORD_IMPLEMENTATION
+#include "stb_record.h"
+
+void DrawChangedLines(Player *player)
+{
+    for (size_t i=0; i<player->line_capacity; ++i) {
+        if (!player->changed[i]) {
+            continue;
+        }
+        player->changed[i] = false;
+        printf("\x1B[%zu;1H\x1B[2K", i + 1);
+        size_t size = player->line_sizes[i];
+        if (size > 0 && player->lines[i][size - 1] == '\n') {
+            size--;
+        }
+        if (size > 0) {
+            fwrite(player->lines[i], 1, size, stdout);
+        }
+    }
+    fflush(stdout);
+}
+
+void SleepMicroseconds(uint64_t microseconds)
+{
+    struct timespec duration = { .tv_sec = microseconds / 1000000, .tv_nsec = (microseconds % 1000000) * 1000 };
+    nanosleep(&duration, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path  = NULL;
+    double speed      = 1.0;
+    double from       = 0.0;
+    for (int i=1; i<argc; ++i) {
+        if (strcmp(argv[i], "--speed=max") == 0) {
+            speed = 0.0;
+        } else if (sscanf(argv[i], "--speed=%lf", &speed) == 1 && speed > 0.0) {
+            continue;
+        } else if (sscanf(argv[i], "--from=%lf", &from) == 1 && from >= 0.0) {
+            continue;
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s FILE [--speed=N|--speed=max] [--from=SECONDS]\n", argv[0]);
+        return 1;
+    }
+
+    Player *player = PlayerOpen(path);
+    if (player == NULL) {
+        return 1;
+    }
+    printf("\x1B[2J");
+    bool playing = from > 0.0 ? PlayerSeek(player, from * 1000000) : PlayerNext(player);
+    while (playing) {
+        DrawChangedLines(player);
+        uint64_t shown = player->timestamp;
+        playing = PlayerNext(player);
+        if (playing && speed > 0.0) {
+            SleepMicroseconds((player->timestamp - shown) / speed);
+        }
+    }
+    printf("\x1B[%zu;1H\n", player->line_count + 1);
+    PlayerClose(player);
+	return 0;
+}
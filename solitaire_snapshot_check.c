@@ -0,0 +1,122 @@
+#define VERSION "1.0"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define STB_SOLITAIRE_IMPLEMENTATION
+#include "stb_solitaire.h"
+#define STB_RACE_IMPLEMENTATION
+#include "stb_race.h"
+
+/* Plays one seeded game with random legal moves next to a copy that is written to a snapshot and read back
+ * before every move, so the copy only ever carries what a snapshot keeps. Both must offer the same moves and hash
+ * the same after each of them, and a cut short or corrupted copy of every snapshot must be rejected. Returns the
+ * number of snapshots checked, or -1 after printing where they first differed. */
+long CheckGame(const Variant *variant, size_t draw_count, unsigned int seed, int max_moves, uint8_t *buffer, uint8_t *damaged, Move history[])
+{
+    Game game, restored;
+    GameInit(&game, variant, seed, draw_count);
+    GameInit(&restored, variant, seed, draw_count);
+    srand(seed);
+
+    int    turns = 0, restored_turns = 0;
+    size_t count = 0;
+    for (;;) {
+        size_t size = GameSnapshotEncode(&restored, seed, restored_turns, history, count, buffer);
+        unsigned int snapshot_seed;
+        int          snapshot_turns;
+        size_t       snapshot_count;
+        Move *moves = GameSnapshotDecode(buffer, size, &restored, &snapshot_seed, &snapshot_turns, &snapshot_count);
+        const char *problem = NULL;
+        if (moves == NULL) {
+            problem = "snapshot was rejected";
+        } else if (size > GAME_SNAPSHOT_SIZE(count)) {
+            problem = "snapshot is larger than GAME_SNAPSHOT_SIZE";
+        } else if (snapshot_seed != seed || snapshot_turns != turns || snapshot_count != count || memcmp(moves, history, count * sizeof(Move)) != 0) {
+            problem = "seed, turns or moves came back different";
+        } else if (RaceHash(&restored) != RaceHash(&game)) {
+            problem = "restored game hashes differently";
+        }
+        free(moves);
+        restored_turns = snapshot_turns;
+
+        memcpy(damaged, buffer, size);
+        size_t at = rand() % size;
+        damaged[at] ^= 1 << (rand() % 8);
+        Game scratch;
+        if (problem == NULL && (moves = GameSnapshotDecode(damaged, size, &scratch, &snapshot_seed, &snapshot_turns, &snapshot_count)) != NULL) {
+            problem = "snapshot with a flipped bit was accepted";
+            free(moves);
+        }
+        if (problem == NULL && (moves = GameSnapshotDecode(buffer, rand() % size, &scratch, &snapshot_seed, &snapshot_turns, &snapshot_count)) != NULL) {
+            problem = "truncated snapshot was accepted";
+            free(moves);
+        }
+
+        Move moves_game[MAX_MOVES], moves_restored[MAX_MOVES];
+        size_t available = variant->generate_moves(&game, moves_game);
+        if (problem == NULL && (variant->generate_moves(&restored, moves_restored) != available
+                || memcmp(moves_game, moves_restored, available * sizeof(Move)) != 0)) {
+            problem = "restored game offers different moves";
+        }
+        if (problem != NULL) {
+            printf("%-9s draw %zu seed %10u move %4zu: %s\n", variant->name, draw_count, seed, count, problem);
+            return -1;
+        }
+        if (available == 0 || (int) count == max_moves || IsGameFinished(&game)) {
+            return count + 1;
+        }
+        Move move = moves_game[rand() % available];
+        history[count++] = move;
+        turns          += variant->apply_move(&game, move);
+        restored_turns += variant->apply_move(&restored, move);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int          games     = 50;
+    int          max_moves = 300;
+    unsigned int seed      = 1;
+    for (int i=1; i<argc; ++i) {
+        if (sscanf(argv[i], "--moves=%d", &max_moves) == 1 && max_moves >= 0) {
+            continue;
+        } else if (sscanf(argv[i], "--seed=%u", &seed) == 1) {
+            continue;
+        } else if (sscanf(argv[i], "--games=%d", &games) != 1 || games < 1) {
+            fprintf(stderr, "Usage: %s [--games=N] [--moves=N] [--seed=N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    uint8_t *buffer  = malloc(GAME_SNAPSHOT_SIZE(max_moves));
+    uint8_t *damaged = malloc(GAME_SNAPSHOT_SIZE(max_moves));
+    Move    *history = malloc((max_moves + 1) * sizeof(Move));
+    if (buffer == NULL || damaged == NULL || history == NULL) {
+        fprintf(stderr, "%s:%d: Couldn't allocate the snapshot buffers\n", __FILE__, __LINE__);
+        return 1;
+    }
+
+    int failures = 0;
+    for (size_t i=0; i<variant_count; ++i) {
+        for (size_t draw_count=1; draw_count<=3; draw_count+=2) {
+            long snapshots = 0;
+            int  failed    = 0;
+            for (int j=0; j<games; ++j) {
+                long checked = CheckGame(variants[i], draw_count, seed + j, max_moves, buffer, damaged, history);
+                failed    += checked < 0;
+                snapshots += checked < 0 ? 0 : checked;
+            }
+            printf("%-9s draw %zu: %d games, %7ld snapshots: %s\n", variants[i]->name, draw_count, games, snapshots, failed ? "FAILED" : "identical");
+            failures += failed;
+        }
+    }
+    printf("%d of %d games survived every snapshot\n", 2 * (int) variant_count * games - failures, 2 * (int) variant_count * games);
+    free(buffer);
+    free(damaged);
+    free(history);
+	return failures > 0;
+}
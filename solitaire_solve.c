@@ -0,0 +1,99 @@
+#define VERSION "1.0"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#define STB_SOLITAIRE_IMPLEMENTATION
+#include "stb_solitaire.h"
+#define STB_SOLVER_IMPLEMENTATION
+#include "stb_solver.h"
+
+double NowSeconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    const Variant *variant    = variants[0];
+    size_t         draw_count = 3;
+    unsigned int   first_seed = 1;
+    unsigned int   last_seed  = 100;
+    size_t         memory_mb  = 64;
+    const char    *disk_path  = NULL;
+    size_t         disk_mb    = 1024;
+    size_t         node_limit = 2000000;
+    bool           verbose    = false;
+    for (int i=1; i<argc; ++i) {
+        if (strncmp(argv[i], "--disk=", 7) == 0) {
+            disk_path = argv[i] + 7;
+        } else if (strncmp(argv[i], "--game=", 7) == 0 && FindVariant(argv[i] + 7) != NULL) {
+            variant = FindVariant(argv[i] + 7);
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (sscanf(argv[i], "--seeds=%u-%u", &first_seed, &last_seed) == 2 && first_seed <= last_seed) {
+            continue;
+        } else if (sscanf(argv[i], "--memory=%zu", &memory_mb) == 1 && memory_mb > 0) {
+            continue;
+        } else if (sscanf(argv[i], "--disk-size=%zu", &disk_mb) == 1 && disk_mb > 0) {
+            continue;
+        } else if (sscanf(argv[i], "--nodes=%zu", &node_limit) == 1) {
+            continue;
+        } else if (sscanf(argv[i], "--draw=%zu", &draw_count) != 1 || (draw_count != 1 && draw_count != 3)) {
+            fprintf(stderr, "Usage: %s [--game=klondike|freecell|spider] [--draw=1|--draw=3] [--seeds=FIRST-LAST] [--memory=MB] [--disk=FILE] [--disk-size=MB] [--nodes=N] [--verbose]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Solver solver = { .node_limit = node_limit };
+    solver.table  = TableOpen(memory_mb << 20, disk_path, disk_mb << 20);
+    if (solver.table == NULL) {
+        return 1;
+    }
+
+    size_t counts[3] = {0};
+    size_t dead      = 0;
+    size_t nodes     = 0;
+    double started   = NowSeconds();
+    for (unsigned int seed=first_seed; ; ++seed) {
+        Game game;
+        GameInit(&game, variant, seed, draw_count);
+        if (variant->find_dead_pattern(&game, NULL) != DEAD_NONE) {
+            dead++;
+            if (verbose) {
+                printf("%10u: dead deal\n", seed);
+            }
+        } else {
+            double      begun  = NowSeconds();
+            SolveResult result = Solve(&solver, &game);
+            counts[result]++;
+            nodes += solver.nodes;
+            if (verbose) {
+                static const char *names[] = { "won", "lost", "unknown" };
+                printf("%10u: %-7s %9zu nodes %5zu moves %8.3f s\n", seed, names[result], solver.nodes,
+                    result == SOLVE_WON ? solver.solution_length : 0, NowSeconds() - begun);
+                fflush(stdout);
+            }
+        }
+        if (seed == last_seed) {
+            break;
+        }
+    }
+
+    Table *table = solver.table;
+    printf("%s draw %zu seeds %u-%u: %zu won, %zu lost, %zu unknown, %zu dead in %.2f s, %zu nodes\n",
+        variant->name, draw_count, first_seed, last_seed, counts[SOLVE_WON], counts[SOLVE_LOST], counts[SOLVE_UNKNOWN],
+        dead, NowSeconds() - started, nodes);
+    printf("table: %zu MB memory, %zu MB disk, %zu hot hits, %zu disk hits, %zu misses, %zu spilled, %zu dropped, %zu prefetched\n",
+        table->hot_count * sizeof(TableBucket) >> 20, table->disk_bytes >> 20, table->hot_hits, table->disk_hits,
+        table->misses, table->spills, table->drops, table->prefetches);
+    SolverFree(&solver);
+    TableClose(table);
+	return 0;
+}
@@ -0,0 +1,297 @@
+#ifndef STB_ANALYST_H
+#define STB_ANALYST_H
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include "stb_solitaire.h"
+    #include "stb_solver.h"
+
+    #define ANALYSIS_MAX_SAFE   64
+    #define ANALYST_CACHE_SETS  512
+    #define ANALYST_CACHE_WAYS  4
+
+    /* What is known about one position: how many moves are legal, the move to suggest, the safe moves to the
+     * foundations that can be played right away and whether the position can still be won. */
+    typedef struct Analysis {
+        uint64_t    key;
+        size_t      move_count;
+        bool        has_hint;
+        Move        hint;
+        Move        safe[ANALYSIS_MAX_SAFE];
+        size_t      safe_count;
+        SolveResult result;
+    } Analysis;
+
+    typedef struct Analyst Analyst;
+
+    uint64_t AnalysisKey(const Game *game);
+    void     Analyze(Solver *solver, const Game *game, Analysis *analysis);
+
+    Analyst *AnalystOpen(size_t memory_bytes, size_t node_limit);
+    void     AnalystRequest(Analyst *analyst, const Game *game);
+    void     AnalystWait(Analyst *analyst, const Game *game, Analysis *analysis);
+    void     AnalystClose(Analyst *analyst);
+#endif // STB_ANALYST_H
+
+#if defined(STB_ANALYST_IMPLEMENTATION) && !defined(STB_ANALYST_IMPLEMENTED)
+#define STB_ANALYST_IMPLEMENTED
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+    /* Hints name piles, so analyses are keyed by the exact position. */
+    uint64_t AnalysisKey(const Game *game)
+    {
+        return ExactPositionKey(game);
+    }
+
+    void Analyze(Solver *solver, const Game *game, Analysis *analysis)
+    {
+        Move moves[MAX_MOVES];
+        memset(analysis, 0, sizeof(Analysis));
+        analysis->key        = AnalysisKey(game);
+        analysis->move_count = game->variant->generate_moves(game, moves);
+
+        Game copy = *game;
+        while (analysis->safe_count < ANALYSIS_MAX_SAFE && game->variant->find_safe_move(&copy, &analysis->safe[analysis->safe_count])) {
+            game->variant->apply_move(&copy, analysis->safe[analysis->safe_count++]);
+        }
+
+        analysis->result = Solve(solver, game);
+        if (analysis->result == SOLVE_WON && solver->solution_length > 0) {
+            analysis->hint     = solver->solution[0];
+            analysis->has_hint = true;
+            return;
+        }
+        int best = -1;
+        for (size_t i=0; i<analysis->move_count; ++i) {
+            int score = MoveScore(game, moves[i]);
+            if (score > best) {
+                best               = score;
+                analysis->hint     = moves[i];
+                analysis->has_hint = true;
+            }
+        }
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    struct Analyst {
+        Solver solver;
+    };
+
+    Analyst *AnalystOpen(size_t memory_bytes, size_t node_limit)
+    {
+        Analyst *analyst = calloc(1, sizeof(Analyst));
+        if (analyst == NULL) {
+            return NULL;
+        }
+        analyst->solver.node_limit = node_limit;
+        analyst->solver.table      = TableOpen(memory_bytes, NULL, 0);
+        if (analyst->solver.table == NULL) {
+            free(analyst);
+            return NULL;
+        }
+        return analyst;
+    }
+    void AnalystRequest(Analyst *analyst, const Game *game) {}
+    void AnalystWait(Analyst *analyst, const Game *game, Analysis *analysis)
+    {
+        Analyze(&analyst->solver, game, analysis);
+    }
+    void AnalystClose(Analyst *analyst)
+    {
+        if (analyst != NULL) {
+            SolverFree(&analyst->solver);
+            TableClose(analyst->solver.table);
+            free(analyst);
+        }
+    }
+#else
+    #include <pthread.h>
+
+    typedef struct AnalystEntry {
+        Analysis analysis;
+        uint64_t used;
+        bool     valid;
+    } AnalystEntry;
+
+    /* One worker analyzes the last requested position while the player is thinking. A new request cancels the
+     * analysis in progress. Finished analyses are cached by position in sets of ANALYST_CACHE_WAYS entries that
+     * evict the least recently used one, so going back to a position, by undoing a move for instance, finds its
+     * analysis ready even if another position of the game maps to the same set. */
+    struct Analyst {
+        Solver          solver;
+        pthread_t       worker;
+        pthread_mutex_t lock;
+        pthread_cond_t  wakeup;
+        pthread_cond_t  done;
+        Game            request;
+        Game            game;
+        Analysis        analysis;
+        uint64_t        requested;
+        uint64_t        working;
+        bool            pending;
+        bool            busy;
+        bool            stopping;
+        _Atomic bool    cancel;
+        uint64_t        clock;
+        AnalystEntry    cache[ANALYST_CACHE_SETS][ANALYST_CACHE_WAYS];
+    };
+
+    /* Keys always have their low bit set, so the set is picked from the bits above it. */
+    static AnalystEntry *AnalystSet(Analyst *analyst, uint64_t key)
+    {
+        return analyst->cache[(key >> 1) % ANALYST_CACHE_SETS];
+    }
+
+    /* Must be called with the lock held. Returns the cached analysis of the position or NULL. */
+    static const Analysis *AnalystFind(Analyst *analyst, uint64_t key)
+    {
+        AnalystEntry *set = AnalystSet(analyst, key);
+        for (int i=0; i<ANALYST_CACHE_WAYS; ++i) {
+            if (set[i].valid && set[i].analysis.key == key) {
+                set[i].used = ++analyst->clock;
+                return &set[i].analysis;
+            }
+        }
+        return NULL;
+    }
+
+    /* Must be called with the lock held. */
+    static void AnalystStore(Analyst *analyst, const Analysis *analysis)
+    {
+        AnalystEntry *set    = AnalystSet(analyst, analysis->key);
+        AnalystEntry *victim = &set[0];
+        for (int i=0; i<ANALYST_CACHE_WAYS; ++i) {
+            if (set[i].valid && set[i].analysis.key == analysis->key) {
+                victim = &set[i];
+                break;
+            }
+            if (victim->valid && (!set[i].valid || set[i].used < victim->used)) {
+                victim = &set[i];
+            }
+        }
+        *victim = (AnalystEntry) { .analysis = *analysis, .used = ++analyst->clock, .valid = true };
+    }
+
+    void *AnalystWorker(void *arg)
+    {
+        Analyst  *analyst  = arg;
+        Game     *game     = &analyst->game;
+        Analysis *analysis = &analyst->analysis;
+        for (;;) {
+            pthread_mutex_lock(&analyst->lock);
+            while (!analyst->pending && !analyst->stopping) {
+                pthread_cond_wait(&analyst->wakeup, &analyst->lock);
+            }
+            if (analyst->stopping) {
+                pthread_mutex_unlock(&analyst->lock);
+                break;
+            }
+            *game            = analyst->request;
+            analyst->working = analyst->requested;
+            analyst->busy    = true;
+            analyst->pending = false;
+            atomic_store_explicit(&analyst->cancel, false, memory_order_relaxed);
+            pthread_mutex_unlock(&analyst->lock);
+
+            Analyze(&analyst->solver, game, analysis);
+
+            pthread_mutex_lock(&analyst->lock);
+            if (!atomic_load_explicit(&analyst->cancel, memory_order_relaxed)) {
+                AnalystStore(analyst, analysis);
+            }
+            analyst->busy = false;
+            pthread_cond_broadcast(&analyst->done);
+            pthread_mutex_unlock(&analyst->lock);
+        }
+        return NULL;
+    }
+
+    Analyst *AnalystOpen(size_t memory_bytes, size_t node_limit)
+    {
+        Analyst *analyst = calloc(1, sizeof(Analyst));
+        if (analyst == NULL) {
+            return NULL;
+        }
+        analyst->solver.node_limit = node_limit;
+        analyst->solver.cancel     = &analyst->cancel;
+        analyst->solver.table      = TableOpen(memory_bytes, NULL, 0);
+        if (analyst->solver.table == NULL) {
+            free(analyst);
+            return NULL;
+        }
+        pthread_mutex_init(&analyst->lock, NULL);
+        pthread_cond_init(&analyst->wakeup, NULL);
+        pthread_cond_init(&analyst->done, NULL);
+        if (pthread_create(&analyst->worker, NULL, AnalystWorker, analyst) != 0) {
+            fprintf(stderr, "%s:%d: Couldn't start the analysis thread\n", __FILE__, __LINE__);
+            pthread_mutex_destroy(&analyst->lock);
+            pthread_cond_destroy(&analyst->wakeup);
+            pthread_cond_destroy(&analyst->done);
+            TableClose(analyst->solver.table);
+            free(analyst);
+            return NULL;
+        }
+        return analyst;
+    }
+
+    /* Must be called with the lock held. Returns true if the position is cached or being analyzed. */
+    static bool AnalystQueue(Analyst *analyst, const Game *game, uint64_t key)
+    {
+        if (AnalystFind(analyst, key) != NULL || (analyst->busy && analyst->working == key) || (analyst->pending && analyst->requested == key)) {
+            return true;
+        }
+        analyst->request   = *game;
+        analyst->requested = key;
+        analyst->pending   = true;
+        atomic_store_explicit(&analyst->cancel, true, memory_order_relaxed);
+        pthread_cond_signal(&analyst->wakeup);
+        return false;
+    }
+
+    void AnalystRequest(Analyst *analyst, const Game *game)
+    {
+        if (analyst == NULL) {
+            return;
+        }
+        uint64_t key = AnalysisKey(game);
+        pthread_mutex_lock(&analyst->lock);
+        AnalystQueue(analyst, game, key);
+        pthread_mutex_unlock(&analyst->lock);
+    }
+
+    /* Returns the analysis of the position, waiting for the worker if it is not finished yet. */
+    void AnalystWait(Analyst *analyst, const Game *game, Analysis *analysis)
+    {
+        uint64_t key = AnalysisKey(game);
+        pthread_mutex_lock(&analyst->lock);
+        const Analysis *cached;
+        while ((cached = AnalystFind(analyst, key)) == NULL) {
+            AnalystQueue(analyst, game, key);
+            pthread_cond_wait(&analyst->done, &analyst->lock);
+        }
+        *analysis = *cached;
+        pthread_mutex_unlock(&analyst->lock);
+    }
+
+    void AnalystClose(Analyst *analyst)
+    {
+        if (analyst == NULL) {
+            return;
+        }
+        pthread_mutex_lock(&analyst->lock);
+        analyst->stopping = true;
+        atomic_store_explicit(&analyst->cancel, true, memory_order_relaxed);
+        pthread_cond_signal(&analyst->wakeup);
+        pthread_mutex_unlock(&analyst->lock);
+        pthread_join(analyst->worker, NULL);
+        pthread_mutex_destroy(&analyst->lock);
+        pthread_cond_destroy(&analyst->wakeup);
+        pthread_cond_destroy(&analyst->done);
+        SolverFree(&analyst->solver);
+        TableClose(analyst->solver.table);
+        free(analyst);
+    }
+#endif
+#endif // STB_ANALYST_IMPLEMENTATION
@@ -1,6 +1,11 @@
 #ifndef STB_KEYPRESS_H
 #define STB_KEYPRESS_H
+    #include <stdio.h>
+
+    #define KEY_INPUT (-2)
+
     char GetKeyPress();
+    int  GetKeyPressOrInput(int fd);
 #endif // STB_KEYPRESS_H
 
 #ifdef STB_KEYPRESS_IMPLEMENTATION
@@ -9,9 +14,13 @@
     char GetKeyPress() {
         return _getch();
     }
+    int GetKeyPressOrInput(int fd) {
+        return _getch();
+    }
 #else
     #include <unistd.h>
     #include <termios.h>
+    #include <poll.h>
     char GetKeyPress() {
         struct termios oldTermios;
         char ch;
@@ -24,5 +33,23 @@
         tcsetattr(STDIN_FILENO, TCSANOW, &oldTermios);
         return ch;
     }
+    /* Waits for a key press or for `fd` to become readable, whichever comes first. Returns KEY_INPUT for the
+     * latter and EOF once stdin is closed. Reads stdin unbuffered, so do not mix it with GetKeyPress. */
+    int GetKeyPressOrInput(int fd) {
+        struct termios oldTermios;
+        unsigned char ch;
+        struct termios newTermios;
+        struct pollfd fds[2] = { { .fd = STDIN_FILENO, .events = POLLIN }, { .fd = fd, .events = POLLIN } };
+        tcgetattr(STDIN_FILENO, &oldTermios);
+        newTermios = oldTermios;
+        newTermios.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &newTermios);
+        int result = KEY_INPUT;
+        if (poll(fds, 2, -1) > 0 && fds[0].revents != 0) {
+            result = read(STDIN_FILENO, &ch, 1) == 1 ? ch : EOF;
+        }
+        tcsetattr(STDIN_FILENO, TCSANOW, &oldTermios);
+        return result;
+    }
 #endif
 #endif // STB_KEYPRESS_IMPLEMENTATION
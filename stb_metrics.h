@@ -0,0 +1,166 @@
+#ifndef STB_METRICS_H
+#define STB_METRICS_H
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include <stdatomic.h>
+
+    #define METRICS_MAGIC           0x4d4c4f53
+    #define METRICS_VERSION         1
+    #define METRICS_PREFIX          "solitaire-metrics."
+    #define METRICS_DIRECTORY       "/dev/shm"
+    #define METRICS_LATENCY_BUCKETS 24
+
+    typedef enum MetricCounter {
+        METRIC_FRAMES,
+        METRIC_BYTES,
+        METRIC_MOVES,
+        METRIC_REJECTED,
+        METRIC_COUNT
+    } MetricCounter;
+
+    /* Every process owns one segment and is its only writer, so counters are bumped with a relaxed load and
+     * store instead of a locked read-modify-write. Readers may see a value one update behind, never a torn one.
+     * Latency bucket i counts samples below 2^i microseconds, the last bucket also takes everything above. */
+    typedef struct Metrics {
+        uint32_t         magic;
+        uint32_t         version;
+        int32_t          pid;
+        char             program[28];
+        uint64_t         started;
+        _Atomic uint64_t counters[METRIC_COUNT];
+        _Atomic uint64_t latency[METRICS_LATENCY_BUCKETS];
+    } Metrics;
+
+    Metrics  *MetricsOpen(const char *program);
+    void      MetricsClose(Metrics *metrics);
+    Metrics  *MetricsAttach(const char *name);
+    void      MetricsDetach(Metrics *metrics);
+    void      MetricsAdd(Metrics *metrics, MetricCounter counter, uint64_t amount);
+    void      MetricsLatency(Metrics *metrics, uint64_t microseconds);
+    uint64_t  MetricsNow(void);
+#endif // STB_METRICS_H
+
+#ifdef STB_METRICS_IMPLEMENTATION
+    #include <stdio.h>
+    #include <string.h>
+
+    void MetricsAdd(Metrics *metrics, MetricCounter counter, uint64_t amount)
+    {
+        if (metrics == NULL) {
+            return;
+        }
+        uint64_t value = atomic_load_explicit(&metrics->counters[counter], memory_order_relaxed);
+        atomic_store_explicit(&metrics->counters[counter], value + amount, memory_order_relaxed);
+    }
+
+    void MetricsLatency(Metrics *metrics, uint64_t microseconds)
+    {
+        if (metrics == NULL) {
+            return;
+        }
+        size_t bucket = 0;
+        while (bucket < METRICS_LATENCY_BUCKETS - 1 && microseconds >= (1ull << bucket)) {
+            bucket++;
+        }
+        uint64_t value = atomic_load_explicit(&metrics->latency[bucket], memory_order_relaxed);
+        atomic_store_explicit(&metrics->latency[bucket], value + 1, memory_order_relaxed);
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    Metrics *MetricsOpen(const char *program) { return NULL; }
+    void     MetricsClose(Metrics *metrics) {}
+    Metrics *MetricsAttach(const char *name) { return NULL; }
+    void     MetricsDetach(Metrics *metrics) {}
+    uint64_t MetricsNow(void) { return 0; }
+#else
+    #include <time.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+
+    uint64_t MetricsNow(void)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    }
+
+    Metrics *MetricsOpen(const char *program)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "/" METRICS_PREFIX "%ld", (long) getpid());
+        int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "%s:%d: Couldn't create metrics segment %s\n", __FILE__, __LINE__, name);
+            return NULL;
+        }
+        if (ftruncate(fd, sizeof(Metrics)) != 0) {
+            fprintf(stderr, "%s:%d: Couldn't size metrics segment %s\n", __FILE__, __LINE__, name);
+            close(fd);
+            shm_unlink(name);
+            return NULL;
+        }
+        Metrics *metrics = mmap(NULL, sizeof(Metrics), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (metrics == MAP_FAILED) {
+            fprintf(stderr, "%s:%d: Couldn't map metrics segment %s\n", __FILE__, __LINE__, name);
+            shm_unlink(name);
+            return NULL;
+        }
+        metrics->version = METRICS_VERSION;
+        metrics->pid     = getpid();
+        metrics->started = time(NULL);
+        strncpy(metrics->program, program, sizeof(metrics->program) - 1);
+        atomic_thread_fence(memory_order_release);
+        metrics->magic   = METRICS_MAGIC;
+        return metrics;
+    }
+
+    void MetricsClose(Metrics *metrics)
+    {
+        if (metrics == NULL) {
+            return;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "/" METRICS_PREFIX "%ld", (long) metrics->pid);
+        munmap(metrics, sizeof(Metrics));
+        shm_unlink(name);
+    }
+
+    /* Maps the segment called name (as listed in METRICS_DIRECTORY) read-only. Returns NULL for segments that
+     * are not metrics or were written by another version. */
+    Metrics *MetricsAttach(const char *name)
+    {
+        char path[300];
+        snprintf(path, sizeof(path), "/%s", name);
+        int fd = shm_open(path, O_RDONLY, 0);
+        struct stat info;
+        if (fd < 0) {
+            return NULL;
+        }
+        if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(Metrics)) {
+            close(fd);
+            return NULL;
+        }
+        Metrics *metrics = mmap(NULL, sizeof(Metrics), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (metrics == MAP_FAILED) {
+            return NULL;
+        }
+        if (metrics->magic != METRICS_MAGIC || metrics->version != METRICS_VERSION) {
+            munmap(metrics, sizeof(Metrics));
+            return NULL;
+        }
+        atomic_thread_fence(memory_order_acquire);
+        return metrics;
+    }
+
+    void MetricsDetach(Metrics *metrics)
+    {
+        if (metrics != NULL) {
+            munmap(metrics, sizeof(Metrics));
+        }
+    }
+#endif
+#endif // STB_METRICS_IMPLEMENTATION
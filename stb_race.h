@@ -0,0 +1,581 @@
+#ifndef STB_RACE_H
+#define STB_RACE_H
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include "stb_solitaire.h"
+
+    #define RACE_MAX_PLAYERS    8
+    #define RACE_DEFAULT_SOCKET "/tmp/solitaire-race.sock"
+
+    typedef enum RaceKind {
+        RACE_JOIN,
+        RACE_START,
+        RACE_MOVE,
+        RACE_LEAVE,
+    } RaceKind;
+
+    /* Every message has the same size on the wire. Peers share one machine, so fields are sent in host order.
+     * JOIN carries the variant and draw count the player asked for, START the ones the relay picked together with
+     * the seed in `value`. MOVE carries the hash of the sender's game after the move in `value` and the sender's
+     * monotonic clock in microseconds in `stamp`. */
+    typedef struct RaceMessage {
+        uint8_t  kind;
+        uint8_t  player;
+        uint8_t  players;
+        uint8_t  variant;
+        uint8_t  draw_count;
+        uint8_t  reserved[3];
+        Move     move;
+        uint32_t value;
+        uint32_t stamp;
+    } RaceMessage;
+
+    /* One client's view of the race. Every player's game, its own included, is rebuilt from the moves alone
+     * with the same rules, so all clients hold identical copies. `desync` is set when a replayed move is illegal
+     * or leaves a different hash than the sender reported. */
+    typedef struct Race {
+        int            fd;
+        int            player;
+        int            players;
+        unsigned int   seed;
+        const Variant *variant;
+        size_t         draw_count;
+        Game           games[RACE_MAX_PLAYERS];
+        int            turns[RACE_MAX_PLAYERS];
+        bool           left[RACE_MAX_PLAYERS];
+        bool           desync[RACE_MAX_PLAYERS];
+        uint64_t       latency_total;
+        uint32_t       latency_max;
+        size_t         latency_count;
+    } Race;
+
+    /* The relay's copy of one player's game, rebuilt from the moves it forwards. `game` and `moves` are NULL while
+     * the session hibernates in `snapshot_size` bytes on disk. */
+    typedef struct RaceSession {
+        Game    *game;
+        Move    *moves;
+        size_t   move_count;
+        size_t   move_capacity;
+        int      turns;
+        bool     desync;
+        uint64_t active;
+        size_t   snapshot_size;
+    } RaceSession;
+
+    /* Lets the relay keep every player's game. With `hibernate_dir` set, a session that has seen no move for
+     * `idle_ms` is written to a snapshot file there and its memory given back until the player's next move. The
+     * counters add up the time spent hibernating and restoring sessions. */
+    typedef struct RaceHost {
+        const char  *hibernate_dir;
+        int          idle_ms;
+        int          players;
+        RaceSession  sessions[RACE_MAX_PLAYERS];
+        size_t       hibernations;
+        size_t       restores;
+        uint64_t     hibernate_us;
+        uint64_t     restore_us;
+    } RaceHost;
+
+    int      RaceListen(const char *address);
+    int      RaceConnect(const char *address);
+    bool     RaceSend(int fd, const RaceMessage *message);
+    bool     RaceReceive(int fd, RaceMessage *message);
+    uint32_t RaceHash(const Game *game);
+    int      RaceRelay(int listen_fd, int players, unsigned int seed, RaceHost *host);
+    void     RaceHostClose(RaceHost *host);
+
+    Race    *RaceJoin(const char *address, const Variant *variant, size_t draw_count);
+    void     RaceSendMove(Race *race, Move move);
+    bool     RacePoll(Race *race, int timeout_ms);
+    void     RaceFormatStatus(const Race *race, char *buffer, size_t size);
+    void     RaceLeave(Race *race);
+#endif // STB_RACE_H
+
+#ifdef STB_RACE_IMPLEMENTATION
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+    /* FNV-1a over every card of every pile in order, the stock split included through the poll and deck sizes. */
+    uint32_t RaceHash(const Game *game)
+    {
+        uint32_t hash = 2166136261u;
+        for (int i=0; i<game->pile_count; ++i) {
+            size_t size = PileSize(game, i);
+            for (size_t j=0; j<=size; ++j) {
+                uint32_t value = j < size ? (uint32_t) PileCard(game, i, j).number << 1 | PileCard(game, i, j).hidden : 0xffffffffu;
+                for (int k=0; k<4; ++k) {
+                    hash = (hash ^ ((value >> (8 * k)) & 0xff)) * 16777619u;
+                }
+            }
+        }
+        return hash;
+    }
+
+    int RaceCollected(const Game *game)
+    {
+        int collected = 0;
+        for (int i=0; i<game->variant->foundations; ++i) {
+            collected += game->piles[FOUNDATION_ID(game, i)].size;
+        }
+        return collected;
+    }
+
+    void RaceFormatStatus(const Race *race, char *buffer, size_t size)
+    {
+        size_t used = 0;
+        buffer[0]   = '\0';
+        for (int i=0; i<race->players && used<size; ++i) {
+            used += snprintf(buffer + used, size - used, "%sP%d%s %d/%zu #%d%s%s", i > 0 ? " | " : "", i + 1,
+                i == race->player ? "(you)" : "", RaceCollected(&race->games[i]), race->games[i].card_count, race->turns[i],
+                race->left[i] ? " left" : "", race->desync[i] ? " DESYNC" : "");
+        }
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    int RaceListen(const char *address)
+    {
+        fprintf(stderr, "%s:%d: Racing is not supported on this platform\n", __FILE__, __LINE__);
+        return -1;
+    }
+    int   RaceConnect(const char *address) { return RaceListen(address); }
+    bool  RaceSend(int fd, const RaceMessage *message) { return false; }
+    bool  RaceReceive(int fd, RaceMessage *message) { return false; }
+    int   RaceRelay(int listen_fd, int players, unsigned int seed, RaceHost *host) { return 1; }
+    void  RaceHostClose(RaceHost *host) {}
+    Race *RaceJoin(const char *address, const Variant *variant, size_t draw_count) { RaceListen(address); return NULL; }
+    void  RaceSendMove(Race *race, Move move) {}
+    bool  RacePoll(Race *race, int timeout_ms) { return false; }
+    void  RaceLeave(Race *race) {}
+#else
+    #include <time.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+
+    /* `address` is either `tcp:PORT` for the loopback interface or the path of a Unix socket. */
+    int RaceSocket(const char *address, bool listening)
+    {
+        int port, fd;
+        if (sscanf(address, "tcp:%d", &port) == 1) {
+            struct sockaddr_in local = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+            int enable = 1;
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0) {
+                return -1;
+            }
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+            if (listening ? bind(fd, (struct sockaddr*) &local, sizeof(local)) != 0 || listen(fd, RACE_MAX_PLAYERS) != 0
+                          : connect(fd, (struct sockaddr*) &local, sizeof(local)) != 0) {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+        struct sockaddr_un local = { .sun_family = AF_UNIX };
+        if (strlen(address) >= sizeof(local.sun_path)) {
+            return -1;
+        }
+        strcpy(local.sun_path, address);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (listening) {
+            unlink(address);
+        }
+        if (listening ? bind(fd, (struct sockaddr*) &local, sizeof(local)) != 0 || listen(fd, RACE_MAX_PLAYERS) != 0
+                      : connect(fd, (struct sockaddr*) &local, sizeof(local)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    int RaceListen(const char *address)
+    {
+        int fd = RaceSocket(address, true);
+        if (fd < 0) {
+            fprintf(stderr, "%s:%d: Couldn't listen on %s\n", __FILE__, __LINE__, address);
+        }
+        return fd;
+    }
+
+    int RaceConnect(const char *address)
+    {
+        int fd = RaceSocket(address, false);
+        if (fd < 0) {
+            fprintf(stderr, "%s:%d: Couldn't connect to %s\n", __FILE__, __LINE__, address);
+        }
+        return fd;
+    }
+
+    bool RaceSend(int fd, const RaceMessage *message)
+    {
+        return send(fd, message, sizeof(RaceMessage), MSG_NOSIGNAL) == sizeof(RaceMessage);
+    }
+
+    /* Blocks until a whole message arrives. Returns false once the peer is gone. */
+    bool RaceReceive(int fd, RaceMessage *message)
+    {
+        size_t received = 0;
+        while (received < sizeof(RaceMessage)) {
+            ssize_t count = recv(fd, (char*) message + received, sizeof(RaceMessage) - received, 0);
+            if (count <= 0) {
+                return false;
+            }
+            received += count;
+        }
+        return true;
+    }
+
+    uint64_t RaceClock(void)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    }
+
+    uint32_t RaceStamp(void)
+    {
+        return (uint32_t) RaceClock();
+    }
+
+    void RaceSessionPath(const RaceHost *host, int player, char *path, size_t size)
+    {
+        snprintf(path, size, "%s/solitaire-relay-%d-p%d.snap", host->hibernate_dir, (int) getpid(), player + 1);
+    }
+
+    /* Writes the session to its snapshot file and frees its game and moves. Leaves it in memory on failure. */
+    bool RaceHibernate(RaceHost *host, int player, unsigned int seed)
+    {
+        RaceSession *session = &host->sessions[player];
+        uint64_t     started = RaceClock();
+        uint8_t     *buffer  = malloc(GAME_SNAPSHOT_SIZE(session->move_count));
+        char         path[512];
+        RaceSessionPath(host, player, path, sizeof(path));
+        FILE *file = buffer != NULL ? fopen(path, "wb") : NULL;
+        if (file == NULL) {
+            fprintf(stderr, "%s:%d: Couldn't hibernate player %d to %s\n", __FILE__, __LINE__, player + 1, path);
+            free(buffer);
+            return false;
+        }
+        size_t size    = GameSnapshotEncode(session->game, seed, session->turns, session->moves, session->move_count, buffer);
+        bool   written = fwrite(buffer, 1, size, file) == size;
+        written &= fclose(file) == 0;
+        free(buffer);
+        if (!written) {
+            fprintf(stderr, "%s:%d: Couldn't hibernate player %d to %s\n", __FILE__, __LINE__, player + 1, path);
+            unlink(path);
+            return false;
+        }
+        free(session->game);
+        free(session->moves);
+        session->game          = NULL;
+        session->moves         = NULL;
+        session->move_capacity = session->move_count;
+        session->snapshot_size = size;
+        host->hibernations++;
+        host->hibernate_us += RaceClock() - started;
+        return true;
+    }
+
+    /* Brings a hibernating session back from its snapshot file. A snapshot that cannot be read leaves the session
+     * on a fresh deal and marked out of sync. */
+    bool RaceRestore(RaceHost *host, int player, const Variant *variant, unsigned int seed, size_t draw_count)
+    {
+        RaceSession *session = &host->sessions[player];
+        if (session->game != NULL) {
+            return true;
+        }
+        uint64_t started = RaceClock();
+        uint8_t *buffer  = malloc(session->snapshot_size);
+        char     path[512];
+        RaceSessionPath(host, player, path, sizeof(path));
+        FILE *file = fopen(path, "rb");
+        session->game = malloc(sizeof(Game));
+        if (file != NULL) {
+            if (buffer != NULL && session->game != NULL && fread(buffer, 1, session->snapshot_size, file) == session->snapshot_size) {
+                unsigned int snapshot_seed;
+                session->moves = GameSnapshotDecode(buffer, session->snapshot_size, session->game, &snapshot_seed,
+                    &session->turns, &session->move_count);
+            }
+            fclose(file);
+            unlink(path);
+        }
+        free(buffer);
+        session->move_capacity = session->move_count;
+        if (session->game == NULL || session->moves == NULL) {
+            fprintf(stderr, "%s:%d: Couldn't restore player %d from %s\n", __FILE__, __LINE__, player + 1, path);
+            if (session->game == NULL) {
+                return false;
+            }
+            GameInit(session->game, variant, seed, draw_count);
+            session->move_count    = 0;
+            session->move_capacity = 0;
+            session->turns         = 0;
+            session->desync        = true;
+            return false;
+        }
+        host->restores++;
+        host->restore_us += RaceClock() - started;
+        return true;
+    }
+
+    /* Replays a forwarded move on the relay's copy of the sender's game. */
+    void RaceHostMove(RaceHost *host, int player, const RaceMessage *message)
+    {
+        RaceSession *session = &host->sessions[player];
+        Game        *game    = session->game;
+        if (game == NULL || game->variant->check_move(game, message->move) != NULL) {
+            session->desync = true;
+            return;
+        }
+        if (session->move_count == session->move_capacity) {
+            session->move_capacity = session->move_capacity > 0 ? 2 * session->move_capacity : 256;
+            session->moves         = realloc(session->moves, session->move_capacity * sizeof(Move));
+        }
+        if (session->moves == NULL) {
+            session->move_count    = 0;
+            session->move_capacity = 0;
+            session->desync        = true;
+            return;
+        }
+        session->moves[session->move_count++] = message->move;
+        session->turns  += game->variant->apply_move(game, message->move);
+        session->desync |= RaceHash(game) != message->value;
+    }
+
+    /* Hibernates the sessions that have been idle for too long. Returns how long poll may wait for the next one,
+     * -1 if no session is left to hibernate. */
+    int RaceHostIdle(RaceHost *host, unsigned int seed)
+    {
+        if (host == NULL || host->hibernate_dir == NULL) {
+            return -1;
+        }
+        uint64_t now     = RaceClock();
+        int      timeout = -1;
+        for (int i=0; i<host->players; ++i) {
+            RaceSession *session = &host->sessions[i];
+            if (session->game == NULL) {
+                continue;
+            }
+            uint64_t idle_until = session->active + (uint64_t) host->idle_ms * 1000;
+            if (now >= idle_until && RaceHibernate(host, i, seed)) {
+                continue;
+            }
+            int remaining = now < idle_until ? (int) ((idle_until - now + 999) / 1000) : host->idle_ms > 1000 ? host->idle_ms : 1000;
+            timeout = timeout < 0 || remaining < timeout ? remaining : timeout;
+        }
+        return timeout;
+    }
+
+    void RaceHostClose(RaceHost *host)
+    {
+        if (host == NULL) {
+            return;
+        }
+        for (int i=0; i<host->players; ++i) {
+            if (host->sessions[i].game == NULL && host->sessions[i].snapshot_size > 0) {
+                char path[512];
+                RaceSessionPath(host, i, path, sizeof(path));
+                unlink(path);
+            }
+            free(host->sessions[i].game);
+            free(host->sessions[i].moves);
+            host->sessions[i] = (RaceSession) {0};
+        }
+    }
+
+    /* Waits for `players` clients, turning away any that ask for an unknown variant or draw count, starts the race
+     * with the variant the first one asked for and forwards every move to all other players until everyone has
+     * disconnected. Players that left keep receiving the others' moves until they disconnect. Without a `host` the
+     * relay never looks into the moves, with one it also plays them on its own copy of every game and leaves all of
+     * them in memory once the race is over. */
+    int RaceRelay(int listen_fd, int players, unsigned int seed, RaceHost *host)
+    {
+        struct pollfd clients[RACE_MAX_PLAYERS];
+        bool          left[RACE_MAX_PLAYERS] = {0};
+        RaceMessage   start = { .kind = RACE_START, .players = players, .value = seed };
+        for (int i=0; i<players; ++i) {
+            RaceMessage join;
+            clients[i].fd     = accept(listen_fd, NULL, NULL);
+            clients[i].events = POLLIN;
+            if (clients[i].fd < 0 || !RaceReceive(clients[i].fd, &join) || join.kind != RACE_JOIN) {
+                fprintf(stderr, "%s:%d: Player %d failed to join\n", __FILE__, __LINE__, i + 1);
+                return 1;
+            }
+            if (join.variant >= variant_count || (join.draw_count != 1 && join.draw_count != 3)) {
+                fprintf(stderr, "%s:%d: Player %d asked for an unknown game, turned away\n", __FILE__, __LINE__, i + 1);
+                close(clients[i--].fd);
+                continue;
+            }
+            if (i == 0) {
+                start.variant    = join.variant;
+                start.draw_count = join.draw_count;
+            }
+        }
+        for (int i=0; i<players; ++i) {
+            start.player = i;
+            RaceSend(clients[i].fd, &start);
+        }
+        const Variant *variant = variants[start.variant];
+        if (host != NULL) {
+            host->players = players;
+            for (int i=0; i<players; ++i) {
+                host->sessions[i] = (RaceSession) { .game = malloc(sizeof(Game)), .active = RaceClock() };
+                if (host->sessions[i].game == NULL) {
+                    RaceHostClose(host);
+                    return 1;
+                }
+                GameInit(host->sessions[i].game, variant, seed, start.draw_count);
+            }
+        }
+
+        int remaining = players;
+        while (remaining > 0) {
+            if (poll(clients, players, RaceHostIdle(host, seed)) < 0) {
+                return 1;
+            }
+            for (int i=0; i<players; ++i) {
+                if (clients[i].fd < 0 || clients[i].revents == 0) {
+                    continue;
+                }
+                RaceMessage message;
+                if (!RaceReceive(clients[i].fd, &message)) {
+                    close(clients[i].fd);
+                    clients[i].fd = -1;
+                    remaining--;
+                    if (left[i]) {
+                        continue;
+                    }
+                    message.kind = RACE_LEAVE;
+                }
+                if (host != NULL && message.kind == RACE_MOVE) {  /* Wake the session up on its next move */
+                    RaceRestore(host, i, variant, seed, start.draw_count);
+                    RaceHostMove(host, i, &message);
+                    host->sessions[i].active = RaceClock();
+                }
+                left[i]       |= message.kind == RACE_LEAVE;
+                message.player = i;
+                for (int j=0; j<players; ++j) {
+                    if (j != i && clients[j].fd >= 0) {
+                        RaceSend(clients[j].fd, &message);
+                    }
+                }
+            }
+        }
+        for (int i=0; host != NULL && i<players; ++i) {
+            RaceRestore(host, i, variant, seed, start.draw_count);
+        }
+        return 0;
+    }
+
+    Race *RaceJoin(const char *address, const Variant *variant, size_t draw_count)
+    {
+        int fd = RaceConnect(address);
+        if (fd < 0) {
+            return NULL;
+        }
+        RaceMessage join = { .kind = RACE_JOIN, .draw_count = draw_count };
+        for (size_t i=0; i<variant_count; ++i) {
+            join.variant = variants[i] == variant ? i : join.variant;
+        }
+        RaceMessage start;
+        if (!RaceSend(fd, &join) || !RaceReceive(fd, &start) || start.kind != RACE_START ||
+            start.players > RACE_MAX_PLAYERS || start.variant >= variant_count
+        ) {
+            fprintf(stderr, "%s:%d: The relay at %s did not start the race\n", __FILE__, __LINE__, address);
+            close(fd);
+            return NULL;
+        }
+        Race *race = calloc(1, sizeof(Race));
+        if (race == NULL) {
+            close(fd);
+            return NULL;
+        }
+        race->fd         = fd;
+        race->player     = start.player;
+        race->players    = start.players;
+        race->seed       = start.value;
+        race->variant    = variants[start.variant];
+        race->draw_count = start.draw_count;
+        for (int i=0; i<race->players; ++i) {
+            GameInit(&race->games[i], race->variant, race->seed, race->draw_count);
+        }
+        return race;
+    }
+
+    /* Replays a move the player has just applied to its own game and sends it to the others. */
+    void RaceSendMove(Race *race, Move move)
+    {
+        if (race == NULL) {
+            return;
+        }
+        Game *game = &race->games[race->player];
+        race->turns[race->player] += race->variant->apply_move(game, move);
+        RaceMessage message = { .kind = RACE_MOVE, .player = race->player, .move = move, .value = RaceHash(game), .stamp = RaceStamp() };
+        RaceSend(race->fd, &message);
+    }
+
+    /* Applies every message that arrives within `timeout_ms` (-1 waits for one). Returns true if any game changed. */
+    bool RacePoll(Race *race, int timeout_ms)
+    {
+        if (race == NULL || race->fd < 0) {
+            return false;
+        }
+        bool changed = false;
+        struct pollfd relay = { .fd = race->fd, .events = POLLIN };
+        while (poll(&relay, 1, changed ? 0 : timeout_ms) > 0) {
+            RaceMessage message;
+            if (!RaceReceive(race->fd, &message)) {
+                for (int i=0; i<race->players; ++i) {
+                    race->left[i] = true;
+                }
+                close(race->fd);
+                race->fd = -1;
+                return true;
+            }
+            changed = true;
+            if (message.player >= race->players || message.player == race->player) {
+                continue;
+            }
+            if (message.kind == RACE_LEAVE) {
+                race->left[message.player] = true;
+                continue;
+            }
+            Game *game = &race->games[message.player];
+            if (race->variant->check_move(game, message.move) != NULL) {
+                race->desync[message.player] = true;
+                continue;
+            }
+            race->turns[message.player] += race->variant->apply_move(game, message.move);
+            race->desync[message.player] |= RaceHash(game) != message.value;
+
+            uint32_t latency = RaceStamp() - message.stamp;
+            race->latency_total += latency;
+            race->latency_max    = latency > race->latency_max ? latency : race->latency_max;
+            race->latency_count++;
+        }
+        return changed;
+    }
+
+    void RaceLeave(Race *race)
+    {
+        if (race == NULL) {
+            return;
+        }
+        RaceMessage message = { .kind = RACE_LEAVE, .player = race->player };
+        if (race->fd >= 0) {
+            RaceSend(race->fd, &message);
+            close(race->fd);
+        }
+        free(race);
+    }
+#endif
+#endif // STB_RACE_IMPLEMENTATION
@@ -0,0 +1,608 @@
+#ifndef STB_RECORD_H
+#define STB_RECORD_H
+    #include <stdio.h>
+    #include <stdint.h>
+    #include <stdbool.h>
+
+    #define RECORD_MAGIC             "SREC"
+    #define RECORD_VERSION           1
+    #define RECORD_KEYFRAME_INTERVAL 32
+    #define RECORD_MAX_LINES         UINT16_MAX
+    #define RECORD_COMPRESS_BOUND(n) ((n) + (n) / 255 + 16)
+
+    /* A recording is a header followed by independently compressed blocks. Each block starts with a keyframe
+     * holding every line of the screen, the frames after it only hold the lines that changed since the previous
+     * frame. Seeking reads block headers only and decodes a single block. Lines are counted in 16 bits, the last
+     * line of a frame taller than RECORD_MAX_LINES holds the rest of it. */
+    typedef struct RecordBlockHeader {
+        uint32_t raw_size;
+        uint32_t packed_size;
+        uint64_t first_timestamp;
+        uint32_t frame_count;
+    } RecordBlockHeader;
+
+    typedef struct Recorder Recorder;
+
+    Recorder *RecorderOpen(const char *path, size_t frame_capacity);
+    FILE     *RecorderScreen(Recorder *recorder);
+    void      RecorderPresent(Recorder *recorder);
+    void      RecorderClose(Recorder *recorder);
+
+    typedef struct Player {
+        FILE     *file;
+        long     *block_offsets;
+        uint64_t *block_timestamps;
+        size_t    block_count;
+        size_t    block_idx;
+        uint8_t  *raw;
+        size_t    raw_size;
+        size_t    raw_pos;
+        char    **lines;
+        size_t   *line_sizes;
+        bool     *changed;
+        size_t    line_capacity;
+        size_t    line_count;
+        uint64_t  timestamp;
+    } Player;
+
+    Player *PlayerOpen(const char *path);
+    bool    PlayerNext(Player *player);
+    bool    PlayerSeek(Player *player, uint64_t timestamp);
+    void    PlayerClose(Player *player);
+
+    size_t RecordCompress(const uint8_t *src, size_t size, uint8_t *dst);
+    size_t RecordDecompress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
+#endif // STB_RECORD_H
+
+#ifdef STB_RECORD_IMPLEMENTATION
+    #include <stdlib.h>
+    #include <string.h>
+
+    #define RECORD_HASH_BITS 12
+
+    size_t RecordEmitSequence(uint8_t *dst, size_t op, const uint8_t *literals, size_t literal_count, size_t offset, size_t match)
+    {
+        size_t token_pos = op++;
+        size_t match_extra = match >= 4 ? match - 4 : 0;
+        dst[token_pos] = (literal_count < 15 ? literal_count : 15) << 4 | (match_extra < 15 ? match_extra : 15);
+        if (literal_count >= 15) {
+            size_t rest = literal_count - 15;
+            for (; rest >= 255; rest -= 255) {
+                dst[op++] = 255;
+            }
+            dst[op++] = rest;
+        }
+        memcpy(dst + op, literals, literal_count);
+        op += literal_count;
+        if (match == 0) {
+            return op;
+        }
+        dst[op++] = offset & 0xff;
+        dst[op++] = offset >> 8;
+        if (match_extra >= 15) {
+            size_t rest = match_extra - 15;
+            for (; rest >= 255; rest -= 255) {
+                dst[op++] = 255;
+            }
+            dst[op++] = rest;
+        }
+        return op;
+    }
+
+    /* LZ77 with a 64K window in the spirit of LZ4. Frames are mostly repeated escape sequences, which this
+     * shrinks well without pulling in a compression library. `dst` must hold RECORD_COMPRESS_BOUND(size) bytes. */
+    size_t RecordCompress(const uint8_t *src, size_t size, uint8_t *dst)
+    {
+        uint32_t table[1 << RECORD_HASH_BITS] = { 0 };
+        size_t ip = 0, anchor = 0, op = 0;
+        while (ip + 4 <= size) {
+            uint32_t sequence;
+            memcpy(&sequence, src + ip, 4);
+            uint32_t hash      = (sequence * 2654435761u) >> (32 - RECORD_HASH_BITS);
+            size_t   candidate = table[hash];
+            table[hash] = ip + 1;
+            if (candidate == 0 || ip - (candidate - 1) > 0xffff || memcmp(src + candidate - 1, src + ip, 4) != 0) {
+                ip++;
+                continue;
+            }
+            candidate--;
+            size_t match = 4;
+            while (ip + match < size && src[candidate + match] == src[ip + match]) {
+                match++;
+            }
+            op = RecordEmitSequence(dst, op, src + anchor, ip - anchor, ip - candidate, match);
+            ip += match;
+            anchor = ip;
+        }
+        return RecordEmitSequence(dst, op, src + anchor, size - anchor, 0, 0);
+    }
+
+    size_t RecordDecompress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity)
+    {
+        size_t ip = 0, op = 0;
+        while (ip < size) {
+            uint8_t token = src[ip++];
+            size_t literal_count = token >> 4;
+            if (literal_count == 15) {
+                while (ip < size && src[ip] == 255) {
+                    literal_count += src[ip++];
+                }
+                literal_count += ip < size ? src[ip++] : 0;
+            }
+            if (ip + literal_count > size || op + literal_count > capacity) {
+                return 0;
+            }
+            memcpy(dst + op, src + ip, literal_count);
+            ip += literal_count;
+            op += literal_count;
+            if (ip >= size) {
+                break;
+            }
+            if (ip + 2 > size) {
+                return 0;
+            }
+            size_t offset = src[ip] | src[ip + 1] << 8;
+            ip += 2;
+            size_t match = (token & 0x0f) + 4;
+            if ((token & 0x0f) == 15) {
+                while (ip < size && src[ip] == 255) {
+                    match += src[ip++];
+                }
+                match += ip < size ? src[ip++] : 0;
+            }
+            if (offset == 0 || offset > op || op + match > capacity) {
+                return 0;
+            }
+            for (size_t i=0; i<match; ++i, ++op) {
+                dst[op] = dst[op - offset];
+            }
+        }
+        return op;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    Recorder *RecorderOpen(const char *path, size_t frame_capacity)
+    {
+        fprintf(stderr, "%s:%d: Recording is not supported on this platform\n", __FILE__, __LINE__);
+        return NULL;
+    }
+    FILE *RecorderScreen(Recorder *recorder) { return stdout; }
+    void  RecorderPresent(Recorder *recorder) {}
+    void  RecorderClose(Recorder *recorder) {}
+#else
+    #include <pthread.h>
+    #include <time.h>
+
+    typedef struct RecordBlock {
+        struct RecordBlock *next;
+        RecordBlockHeader   header;
+        uint8_t            *data;
+    } RecordBlock;
+
+    struct Recorder {
+        FILE            *file;
+        FILE            *screen;
+        char            *frame;
+        size_t           frame_capacity;
+        char            *previous;
+        size_t          *offsets;
+        size_t          *previous_offsets;
+        size_t           offsets_capacity;
+        size_t           previous_count;
+        struct timespec  started;
+        RecordBlock     *block;
+        size_t           block_capacity;
+        pthread_t        writer;
+        pthread_mutex_t  lock;
+        pthread_cond_t   wakeup;
+        RecordBlock     *queue_head;
+        RecordBlock     *queue_tail;
+        bool             stopping;
+    };
+
+    void *RecorderWriter(void *arg)
+    {
+        Recorder *recorder = arg;
+        uint8_t  *packed   = NULL;
+        size_t    packed_capacity = 0;
+        for (;;) {
+            pthread_mutex_lock(&recorder->lock);
+            while (recorder->queue_head == NULL && !recorder->stopping) {
+                pthread_cond_wait(&recorder->wakeup, &recorder->lock);
+            }
+            RecordBlock *block = recorder->queue_head;
+            if (block != NULL) {
+                recorder->queue_head = block->next;
+                if (recorder->queue_head == NULL) {
+                    recorder->queue_tail = NULL;
+                }
+            }
+            pthread_mutex_unlock(&recorder->lock);
+            if (block == NULL) {
+                break;
+            }
+            if (packed_capacity < RECORD_COMPRESS_BOUND(block->header.raw_size)) {
+                packed_capacity = RECORD_COMPRESS_BOUND(block->header.raw_size);
+                packed = realloc(packed, packed_capacity);
+            }
+            if (packed != NULL) {
+                block->header.packed_size = RecordCompress(block->data, block->header.raw_size, packed);
+                fwrite(&block->header, sizeof(block->header), 1, recorder->file);
+                fwrite(packed, 1, block->header.packed_size, recorder->file);
+            }
+            free(block->data);
+            free(block);
+        }
+        free(packed);
+        return NULL;
+    }
+
+    void RecorderAppend(Recorder *recorder, const void *data, size_t size)
+    {
+        RecordBlock *block = recorder->block;
+        if (block->header.raw_size + size > recorder->block_capacity) {
+            recorder->block_capacity = 2 * (block->header.raw_size + size);
+            block->data = realloc(block->data, recorder->block_capacity);
+        }
+        memcpy(block->data + block->header.raw_size, data, size);
+        block->header.raw_size += size;
+    }
+
+    /* Hands the current block to the writer thread. Only the queue link is done under the lock. */
+    void RecorderHandOff(Recorder *recorder)
+    {
+        RecordBlock *block = recorder->block;
+        recorder->block = NULL;
+        if (block == NULL || block->header.frame_count == 0) {
+            if (block != NULL) {
+                free(block->data);
+                free(block);
+            }
+            return;
+        }
+        pthread_mutex_lock(&recorder->lock);
+        if (recorder->queue_tail != NULL) {
+            recorder->queue_tail->next = block;
+        } else {
+            recorder->queue_head = block;
+        }
+        recorder->queue_tail = block;
+        pthread_cond_signal(&recorder->wakeup);
+        pthread_mutex_unlock(&recorder->lock);
+    }
+
+    Recorder *RecorderOpen(const char *path, size_t frame_capacity)
+    {
+        Recorder *recorder = calloc(1, sizeof(Recorder));
+        if (recorder == NULL) {
+            return NULL;
+        }
+        recorder->file             = fopen(path, "wb");
+        recorder->frame            = malloc(frame_capacity);
+        recorder->previous         = malloc(frame_capacity);
+        recorder->frame_capacity   = frame_capacity;
+        recorder->offsets          = malloc(64 * sizeof(size_t));
+        recorder->previous_offsets = malloc(64 * sizeof(size_t));
+        recorder->offsets_capacity = 64;
+        if (recorder->file == NULL || recorder->frame == NULL || recorder->previous == NULL ||
+            recorder->offsets == NULL || recorder->previous_offsets == NULL
+        ) {
+            fprintf(stderr, "%s:%d: Couldn't open recording %s\n", __FILE__, __LINE__, path);
+            if (recorder->file != NULL) {
+                fclose(recorder->file);
+            }
+            free(recorder->frame);
+            free(recorder->previous);
+            free(recorder->offsets);
+            free(recorder->previous_offsets);
+            free(recorder);
+            return NULL;
+        }
+        recorder->screen = fmemopen(recorder->frame, frame_capacity, "w");
+        uint32_t version = RECORD_VERSION;
+        fwrite(RECORD_MAGIC, 1, 4, recorder->file);
+        fwrite(&version, sizeof(version), 1, recorder->file);
+        clock_gettime(CLOCK_MONOTONIC, &recorder->started);
+        pthread_mutex_init(&recorder->lock, NULL);
+        pthread_cond_init(&recorder->wakeup, NULL);
+        pthread_create(&recorder->writer, NULL, RecorderWriter, recorder);
+        return recorder;
+    }
+
+    /* Everything drawn for a frame goes to this stream, RecorderPresent then shows and records it in one go. */
+    FILE *RecorderScreen(Recorder *recorder)
+    {
+        return recorder->screen;
+    }
+
+    /* Makes room for the line offsets of a frame with `count` lines, in this frame and the previous one. */
+    bool RecorderReserveLines(Recorder *recorder, size_t count)
+    {
+        if (count + 1 <= recorder->offsets_capacity) {
+            return true;
+        }
+        size_t  capacity = 2 * (count + 1);
+        size_t *offsets  = realloc(recorder->offsets, capacity * sizeof(size_t));
+        if (offsets == NULL) {
+            return false;
+        }
+        recorder->offsets = offsets;
+        offsets = realloc(recorder->previous_offsets, capacity * sizeof(size_t));
+        if (offsets == NULL) {
+            return false;
+        }
+        recorder->previous_offsets = offsets;
+        recorder->offsets_capacity = capacity;
+        return true;
+    }
+
+    void RecorderPresent(Recorder *recorder)
+    {
+        fflush(recorder->screen);
+        size_t size = ftell(recorder->screen);
+        if (size >= recorder->frame_capacity) {
+            size = recorder->frame_capacity - 1;
+        }
+        rewind(recorder->screen);
+        fwrite(recorder->frame, 1, size, stdout);
+        fflush(stdout);
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t timestamp = (now.tv_sec - recorder->started.tv_sec) * 1000000ull + (now.tv_nsec - recorder->started.tv_nsec) / 1000;
+
+        size_t line_count = 0;
+        for (size_t i=0; i<size; ++i) {
+            if ((recorder->frame[i] == '\n' && line_count + 1 < RECORD_MAX_LINES) || i == size - 1) {
+                if (!RecorderReserveLines(recorder, ++line_count)) {
+                    return;
+                }
+                recorder->offsets[line_count] = i + 1;
+            }
+        }
+        size_t *offsets = recorder->offsets;
+        offsets[0] = 0;
+
+        if (recorder->block == NULL) {
+            recorder->block          = calloc(1, sizeof(RecordBlock));
+            recorder->block_capacity = 0;
+            recorder->block->header.first_timestamp = timestamp;
+        }
+        bool keyframe = recorder->block->header.frame_count == 0;
+        uint16_t total = line_count, changed = 0;
+        size_t changed_pos = recorder->block->header.raw_size + sizeof(timestamp) + sizeof(total);
+        RecorderAppend(recorder, &timestamp, sizeof(timestamp));
+        RecorderAppend(recorder, &total, sizeof(total));
+        RecorderAppend(recorder, &changed, sizeof(changed));
+        for (size_t i=0; i<line_count; ++i) {
+            uint16_t index  = i;
+            uint32_t length = offsets[i + 1] - offsets[i];
+            if (!keyframe && i < recorder->previous_count &&
+                length == recorder->previous_offsets[i + 1] - recorder->previous_offsets[i] &&
+                memcmp(recorder->frame + offsets[i], recorder->previous + recorder->previous_offsets[i], length) == 0
+            ) {
+                continue;
+            }
+            RecorderAppend(recorder, &index, sizeof(index));
+            RecorderAppend(recorder, &length, sizeof(length));
+            RecorderAppend(recorder, recorder->frame + offsets[i], length);
+            changed++;
+        }
+        memcpy(recorder->block->data + changed_pos, &changed, sizeof(changed));
+        memcpy(recorder->previous, recorder->frame, size);
+        recorder->offsets          = recorder->previous_offsets;
+        recorder->previous_offsets = offsets;
+        recorder->previous_count   = line_count;
+
+        if (++recorder->block->header.frame_count == RECORD_KEYFRAME_INTERVAL) {
+            RecorderHandOff(recorder);
+        }
+    }
+
+    void RecorderClose(Recorder *recorder)
+    {
+        if (recorder == NULL) {
+            return;
+        }
+        RecorderHandOff(recorder);
+        pthread_mutex_lock(&recorder->lock);
+        recorder->stopping = true;
+        pthread_cond_signal(&recorder->wakeup);
+        pthread_mutex_unlock(&recorder->lock);
+        pthread_join(recorder->writer, NULL);
+        pthread_mutex_destroy(&recorder->lock);
+        pthread_cond_destroy(&recorder->wakeup);
+        fclose(recorder->screen);
+        fclose(recorder->file);
+        free(recorder->frame);
+        free(recorder->previous);
+        free(recorder->offsets);
+        free(recorder->previous_offsets);
+        free(recorder);
+    }
+#endif
+
+    Player *PlayerOpen(const char *path)
+    {
+        Player *player = calloc(1, sizeof(Player));
+        if (player == NULL) {
+            return NULL;
+        }
+        player->file = fopen(path, "rb");
+        char magic[4];
+        uint32_t version;
+        if (player->file == NULL ||
+            fread(magic, 1, 4, player->file) != 4 || memcmp(magic, RECORD_MAGIC, 4) != 0 ||
+            fread(&version, sizeof(version), 1, player->file) != 1 || version != RECORD_VERSION
+        ) {
+            fprintf(stderr, "%s:%d: %s is not a recording\n", __FILE__, __LINE__, path);
+            PlayerClose(player);
+            return NULL;
+        }
+        size_t capacity = 0;
+        RecordBlockHeader header;
+        long offset = ftell(player->file);
+        while (fread(&header, sizeof(header), 1, player->file) == 1) {
+            if (player->block_count == capacity) {
+                capacity = capacity ? 2 * capacity : 64;
+                player->block_offsets    = realloc(player->block_offsets,    capacity * sizeof(long));
+                player->block_timestamps = realloc(player->block_timestamps, capacity * sizeof(uint64_t));
+            }
+            player->block_offsets[player->block_count]    = offset;
+            player->block_timestamps[player->block_count] = header.first_timestamp;
+            player->block_count++;
+            fseek(player->file, header.packed_size, SEEK_CUR);
+            offset = ftell(player->file);
+        }
+        return player;
+    }
+
+    bool PlayerLoadBlock(Player *player, size_t block_idx)
+    {
+        RecordBlockHeader header;
+        fseek(player->file, player->block_offsets[block_idx], SEEK_SET);
+        if (fread(&header, sizeof(header), 1, player->file) != 1) {
+            return false;
+        }
+        uint8_t *packed = malloc(header.packed_size);
+        player->raw     = realloc(player->raw, header.raw_size);
+        if (packed == NULL || player->raw == NULL ||
+            fread(packed, 1, header.packed_size, player->file) != header.packed_size ||
+            RecordDecompress(packed, header.packed_size, player->raw, header.raw_size) != header.raw_size
+        ) {
+            free(packed);
+            return false;
+        }
+        free(packed);
+        player->block_idx = block_idx;
+        player->raw_size  = header.raw_size;
+        player->raw_pos   = 0;
+        return true;
+    }
+
+    /* Copies `size` bytes of the current block into `value`. Returns false if the block ends before them. */
+    bool PlayerRead(Player *player, void *value, size_t size)
+    {
+        if (size > player->raw_size - player->raw_pos) {
+            return false;
+        }
+        memcpy(value, player->raw + player->raw_pos, size);
+        player->raw_pos += size;
+        return true;
+    }
+
+    /* Makes room for `count` lines, the new ones empty and unchanged. */
+    bool PlayerReserveLines(Player *player, size_t count)
+    {
+        if (count <= player->line_capacity) {
+            return true;
+        }
+        size_t capacity = 2 * count;
+        char **lines    = realloc(player->lines, capacity * sizeof(char *));
+        if (lines == NULL) {
+            return false;
+        }
+        player->lines = lines;
+        size_t *line_sizes = realloc(player->line_sizes, capacity * sizeof(size_t));
+        if (line_sizes == NULL) {
+            return false;
+        }
+        player->line_sizes = line_sizes;
+        bool *changed = realloc(player->changed, capacity * sizeof(bool));
+        if (changed == NULL) {
+            return false;
+        }
+        player->changed = changed;
+        for (size_t i=player->line_capacity; i<capacity; ++i) {
+            player->lines[i]      = NULL;
+            player->line_sizes[i] = 0;
+            player->changed[i]    = false;
+        }
+        player->line_capacity = capacity;
+        return true;
+    }
+
+    /* Applies the next frame to `lines` and flags the lines it touched in `changed`. Flags are left for the caller
+     * to clear once drawn, so several frames can be applied before drawing. Returns false at the end of the
+     * recording or on a frame that is cut short or names lines past its line count. */
+    bool PlayerNext(Player *player)
+    {
+        if (player->raw_pos >= player->raw_size) {
+            size_t next = player->raw == NULL ? 0 : player->block_idx + 1;
+            if (next >= player->block_count || !PlayerLoadBlock(player, next)) {
+                return false;
+            }
+        }
+        uint16_t total, changed;
+        if (!PlayerRead(player, &player->timestamp, sizeof(player->timestamp)) ||
+            !PlayerRead(player, &total, sizeof(total)) || !PlayerRead(player, &changed, sizeof(changed)) ||
+            !PlayerReserveLines(player, total)
+        ) {
+            return false;
+        }
+        for (size_t i=total; i<player->line_count; ++i) {
+            player->line_sizes[i] = 0;
+            player->changed[i]    = true;
+        }
+        player->line_count = total;
+        for (size_t i=0; i<changed; ++i) {
+            uint16_t index;
+            uint32_t length;
+            if (!PlayerRead(player, &index, sizeof(index)) || !PlayerRead(player, &length, sizeof(length)) ||
+                index >= total || length > player->raw_size - player->raw_pos
+            ) {
+                return false;
+            }
+            char *line = realloc(player->lines[index], length > 0 ? length : 1);
+            if (line == NULL) {
+                return false;
+            }
+            player->lines[index] = line;
+            PlayerRead(player, line, length);
+            player->line_sizes[index] = length;
+            player->changed[index]    = true;
+        }
+        return true;
+    }
+
+    /* Jumps to the keyframe at or before `timestamp` and applies frames up to it. */
+    bool PlayerSeek(Player *player, uint64_t timestamp)
+    {
+        size_t block_idx = 0;
+        while (block_idx + 1 < player->block_count && player->block_timestamps[block_idx + 1] <= timestamp) {
+            block_idx++;
+        }
+        if (player->block_count == 0 || !PlayerLoadBlock(player, block_idx) || !PlayerNext(player)) {
+            return false;
+        }
+        while (player->raw_pos < player->raw_size) {
+            uint64_t next_timestamp;
+            memcpy(&next_timestamp, player->raw + player->raw_pos, sizeof(next_timestamp));
+            if (next_timestamp > timestamp) {
+                break;
+            }
+            PlayerNext(player);
+        }
+        return true;
+    }
+
+    void PlayerClose(Player *player)
+    {
+        if (player == NULL) {
+            return;
+        }
+        if (player->file != NULL) {
+            fclose(player->file);
+        }
+        for (size_t i=0; i<player->line_capacity; ++i) {
+            free(player->lines[i]);
+        }
+        free(player->lines);
+        free(player->line_sizes);
+        free(player->changed);
+        free(player->block_offsets);
+        free(player->block_timestamps);
+        free(player->raw);
+        free(player);
+    }
+#endif // STB_RECORD_IMPLEMENTATION
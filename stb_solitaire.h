@@ -0,0 +1,827 @@
+#ifndef STB_SOLITAIRE_H
+#define STB_SOLITAIRE_H
+    #include <stdio.h>
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <stdbool.h>
+
+    /* A Game holds the cards of MAX_DECKS decks by value, so the solver, the analyst and the relay can copy it
+     * freely. The default fits the largest built-in variant, define MAX_DECKS when building for more decks. */
+#ifndef MAX_DECKS
+    #define MAX_DECKS              2
+#endif
+    #define MAX_CARDS              (52 * MAX_DECKS)
+    #define MAX_COLUMNS            10
+    #define MAX_PILES              48
+    #define MAX_MOVES              512
+    #define GAME_LOG_MAGIC         "SOLITAIRE-LOG"
+    #define GAME_LOG_VERSION       1
+    #define GAME_SNAPSHOT_MAGIC    0x50414e53u
+    #define GAME_SNAPSHOT_VERSION  1
+    #define GAME_SNAPSHOT_SIZE(move_count) (24 + 2 * MAX_PILES + 6 + 2 * MAX_CARDS + 4 * (move_count))
+
+    #define PILE_CARDS(game, id)   ((game)->cards + (game)->piles[id].offset)
+    #define STOCK_CARDS(game)      ((game)->cards + (game)->stock.offset)
+    #define LAST_NTH_CARD_OF(game, id, n) (PILE_CARDS(game, id)[(game)->piles[id].size-(n)])
+    #define LAST_CARD_OF(game, id) LAST_NTH_CARD_OF(game, id, 1)
+    #define POLL_CARD_OF(game)     (STOCK_CARDS(game)[(game)->stock.split-1])
+    #define SUITE_OF(x)            (((x).number / 13) % 4)
+    #define RANK_OF(x)             ((x).number % 13)
+    #define COLOR_OF(x)            (SUITE_OF(x) / 2)
+
+    #define FOUNDATION_ID(game, i) ((game)->variant->first_foundation + (i))
+    #define CELL_ID(game, i)       ((game)->variant->first_cell + (i))
+    #define COLUMN_ID(game, i)     ((game)->variant->first_column + (i))
+
+    typedef struct Card {
+        int16_t number;
+        bool    hidden;
+    } Card;
+
+    /* A pile is a span of Game.cards. The spans are packed in pile order with the stock last, so a pile grows or
+     * shrinks by shifting the cards of the piles after it, and the game only ever holds as many cards as it deals. */
+    typedef struct Pile {
+        size_t offset;
+        size_t size;
+    } Pile;
+
+    typedef enum PileRole {
+        ROLE_FOUNDATION,
+        ROLE_CELL,
+        ROLE_POLL,
+        ROLE_DECK,
+        ROLE_COLUMN,
+    } PileRole;
+
+    /* `slot` is the horizontal card position of the pile, counted in card widths from the left of the board. */
+    typedef struct PileInfo {
+        PileRole role;
+        int      ordinal;
+        int      slot;
+    } PileInfo;
+
+    /* Where each card currently lives, indexed by card number. Kept up to date by PushCard/PopCard and the stock
+     * functions. Cards in the stock are recorded as the deck pile with their position in Stock.cards, use
+     * LocateCard to tell the poll and the deck apart. */
+    typedef struct CardLocation {
+        int16_t pile_id;
+        int16_t depth;
+    } CardLocation;
+
+    /* The stock and the poll share the last span of Game.cards in draw order: [0..split) is the poll with its top at
+     * split-1, [split..size) is the deck with the next card to draw at split. Drawing and recycling only move split.
+     * stops[] holds every split value reachable by drawing within the current cycle, stops[cursor] being the current one. */
+    typedef struct Stock {
+        size_t   offset;
+        size_t   size;
+        size_t   split;
+        size_t   draw_count;
+        uint16_t stops[MAX_CARDS + 1];
+        size_t   stop_count;
+        size_t   cursor;
+    } Stock;
+
+    typedef enum MoveKind {
+        MOVE_CARDS,
+        MOVE_DRAW,
+    } MoveKind;
+
+    /* MOVE_CARDS takes the cards from `depth` to the top of `source` onto `target`. MOVE_DRAW draws from the deck,
+     * recycles the poll or deals a row, whichever the variant does with its stock. */
+    typedef struct Move {
+        uint8_t kind;
+        int8_t  source;
+        uint8_t depth;
+        int8_t  target;
+    } Move;
+
+    typedef enum DeadPattern {
+        DEAD_NONE,
+        DEAD_NO_MOVES,
+        DEAD_SELF_BLOCKED,
+        DEAD_BLOCKING_CYCLE,
+    } DeadPattern;
+
+    typedef struct Game Game;
+
+    /* Rules of a solitaire game. Each variant is compiled from stb_solitaire_rules.h with its own constants, the
+     * function pointers below are fully specialized and never branch on the variant. */
+    typedef struct Variant {
+        const char *name;
+        int         columns;
+        int         foundations;
+        int         cells;
+        int         decks;
+        int         first_foundation;
+        int         first_cell;
+        int         first_column;
+        int         poll_id;
+        int         deck_id;
+        int         foundation_slot;
+        int         cell_slot;
+        int         poll_slot;
+        int         deck_slot;
+        void        (*deal)(Game *game, Card deck[], size_t size);
+        const char *(*check_move)(const Game *game, Move move);
+        size_t      (*generate_moves)(const Game *game, Move moves[]);
+        bool        (*apply_move)(Game *game, Move move);
+        Move        (*collect_move)(const Game *game, int source);
+        DeadPattern (*find_dead_pattern)(const Game *game, int *card);
+        DeadPattern (*find_dead_cycle)(const Game *game, int *card);
+        bool        (*find_safe_move)(const Game *game, Move *move);
+    } Variant;
+
+    struct Game {
+        const Variant *variant;
+        PileInfo       infos[MAX_PILES];
+        int            pile_count;
+        Pile           piles[MAX_PILES];
+        Stock          stock;
+        size_t         card_count;
+        Card           cards[MAX_CARDS];
+        CardLocation   locations[MAX_CARDS];
+    };
+
+    extern const Variant *variants[];
+    extern const size_t   variant_count;
+
+    const Variant *FindVariant(const char *name);
+    void           GameInit(Game *game, const Variant *variant, unsigned int seed, size_t draw_count);
+    bool           IsGameFinished(const Game *game);
+    size_t         PileSize(const Game *game, int pile_id);
+    Card           PileCard(const Game *game, int pile_id, size_t depth);
+    void           PushCard(Game *game, int pile_id, Card card);
+    Card           PopCard(Game *game, int pile_id);
+    void           MoveCards(Game *game, int source_id, size_t depth, int target_id);
+    void           ResizePile(Game *game, int pile_id, size_t size);
+    CardLocation   LocateCard(const Game *game, int number);
+    const char    *DeadPatternMessage(DeadPattern pattern);
+
+    FILE          *GameLogOpen(const char *path, const Game *game, unsigned int seed);
+    void           GameLogMove(FILE *log, Move move);
+    void           GameLogUndo(FILE *log);
+    Move          *GameLogLoad(const char *path, const Variant **variant, unsigned int *seed, size_t *draw_count, size_t *move_count);
+
+    size_t         GameSnapshotEncode(const Game *game, unsigned int seed, int turns, const Move moves[], size_t move_count, uint8_t *buffer);
+    Move          *GameSnapshotDecode(const uint8_t *buffer, size_t size, Game *game, unsigned int *seed, int *turns, size_t *move_count);
+
+    void           StockInit(Game *game, Card deck[], size_t size);
+    size_t         StockDraw(Stock *stock);
+    void           StockRecycle(Stock *stock);
+    Card           StockTake(Game *game);
+    Card           StockPop(Game *game);
+    size_t         StockSplitAfter(const Stock *stock, size_t draws);
+#endif // STB_SOLITAIRE_H
+
+#if defined(STB_SOLITAIRE_IMPLEMENTATION) && !defined(STB_SOLITAIRE_IMPLEMENTED)
+#define STB_SOLITAIRE_IMPLEMENTED
+    #include <stdlib.h>
+    #include <string.h>
+
+    void StockPlanCycle(Stock *stock)
+    {
+        stock->stop_count = 0;
+        stock->cursor     = 0;
+        size_t split      = stock->split;
+        stock->stops[stock->stop_count++] = split;
+        while (split < stock->size) {
+            split = split + stock->draw_count < stock->size ? split + stock->draw_count : stock->size;
+            stock->stops[stock->stop_count++] = split;
+        }
+    }
+
+    /* `deck` holds the cards with the next one to draw at the end, as they come out of the shuffle. Stock cards are
+     * kept face up, frontends draw the deck face down by its role. */
+    void StockInit(Game *game, Card deck[], size_t size)
+    {
+        Stock *stock = &game->stock;
+        Card  *cards = STOCK_CARDS(game);
+        stock->size  = size;
+        stock->split = 0;
+        for (size_t i=0; i<size; ++i) {
+            cards[i]        = deck[size - 1 - i];
+            cards[i].hidden = false;
+            game->locations[cards[i].number].pile_id = game->variant->deck_id;
+            game->locations[cards[i].number].depth   = i;
+        }
+        StockPlanCycle(stock);
+    }
+
+    /* Returns the number of cards drawn, zero if the deck is empty. */
+    size_t StockDraw(Stock *stock)
+    {
+        if (stock->cursor + 1 >= stock->stop_count) {
+            return 0;
+        }
+        size_t drawn = stock->stops[stock->cursor + 1] - stock->split;
+        stock->cursor++;
+        stock->split = stock->stops[stock->cursor];
+        return drawn;
+    }
+
+    void StockRecycle(Stock *stock)
+    {
+        stock->split = 0;
+        StockPlanCycle(stock);
+    }
+
+    /* Removes the top card of the poll. The deck behind it closes the gap, so only its positions change. */
+    Card StockTake(Game *game)
+    {
+        Stock *stock = &game->stock;
+        Card  *cards = STOCK_CARDS(game);
+        Card   card  = POLL_CARD_OF(game);
+        memmove(&cards[stock->split - 1], &cards[stock->split], (stock->size - stock->split) * sizeof(Card));
+        stock->split--;
+        stock->size--;
+        for (size_t i=stock->split; i<stock->size; ++i) {
+            game->locations[cards[i].number].depth = i;
+        }
+        game->locations[card.number].pile_id = -1;
+        game->locations[card.number].depth   = -1;
+        StockPlanCycle(stock);
+        return card;
+    }
+
+    /* Removes the last card of the deck, for variants that deal from the stock instead of drawing. */
+    Card StockPop(Game *game)
+    {
+        Stock *stock = &game->stock;
+        Card   card  = STOCK_CARDS(game)[--stock->size];
+        game->locations[card.number].pile_id = -1;
+        game->locations[card.number].depth   = -1;
+        StockPlanCycle(stock);
+        return card;
+    }
+
+    /* Split after `draws` more draws, following the cycle into recycles. The poll top is then at split-1. */
+    size_t StockSplitAfter(const Stock *stock, size_t draws)
+    {
+        size_t remaining = stock->stop_count - 1 - stock->cursor;
+        if (draws <= remaining) {
+            return stock->stops[stock->cursor + draws];
+        }
+        size_t cycle_length = (stock->size + stock->draw_count - 1) / stock->draw_count + 1;
+        size_t cycle_draws  = (draws - remaining - 1) % cycle_length;
+        return cycle_draws * stock->draw_count < stock->size ? cycle_draws * stock->draw_count : stock->size;
+    }
+
+    size_t PileSize(const Game *game, int pile_id)
+    {
+        switch (game->infos[pile_id].role) {
+            case ROLE_POLL: return game->stock.split;
+            case ROLE_DECK: return game->stock.size - game->stock.split;
+            default:        return game->piles[pile_id].size;
+        }
+    }
+
+    Card PileCard(const Game *game, int pile_id, size_t depth)
+    {
+        switch (game->infos[pile_id].role) {
+            case ROLE_POLL: return STOCK_CARDS(game)[depth];
+            case ROLE_DECK: return STOCK_CARDS(game)[game->stock.split + depth];
+            default:        return PILE_CARDS(game, pile_id)[depth];
+        }
+    }
+
+    /* Gives the pile `size` cards by adding or removing room at its top. The cards of every later pile and of the
+     * stock are shifted along, their depths stay the same. */
+    void ResizePile(Game *game, int pile_id, size_t size)
+    {
+        Pile  *pile = &game->piles[pile_id];
+        size_t end  = pile->offset + pile->size;
+        size_t used = game->stock.offset + game->stock.size;
+        memmove(&game->cards[pile->offset + size], &game->cards[end], (used - end) * sizeof(Card));
+        for (int i=pile_id+1; i<game->pile_count; ++i) {
+            game->piles[i].offset = game->piles[i].offset + size - pile->size;
+        }
+        game->stock.offset = game->stock.offset + size - pile->size;
+        pile->size         = size;
+    }
+
+    void PushCard(Game *game, int pile_id, Card card)
+    {
+        ResizePile(game, pile_id, game->piles[pile_id].size + 1);
+        LAST_CARD_OF(game, pile_id) = card;
+        game->locations[card.number].pile_id = pile_id;
+        game->locations[card.number].depth   = game->piles[pile_id].size - 1;
+    }
+
+    Card PopCard(Game *game, int pile_id)
+    {
+        Card card = LAST_CARD_OF(game, pile_id);
+        ResizePile(game, pile_id, game->piles[pile_id].size - 1);
+        game->locations[card.number].pile_id = -1;
+        game->locations[card.number].depth   = -1;
+        return card;
+    }
+
+    /* Moves the cards from `depth` to the top of the source pile onto the target pile, keeping their order. */
+    void MoveCards(Game *game, int source_id, size_t depth, int target_id)
+    {
+        Card   moving[MAX_CARDS];
+        size_t count = game->piles[source_id].size - depth;
+        size_t base  = game->piles[target_id].size;
+        memcpy(moving, PILE_CARDS(game, source_id) + depth, count * sizeof(Card));
+        ResizePile(game, source_id, depth);
+        ResizePile(game, target_id, base + count);
+        memcpy(PILE_CARDS(game, target_id) + base, moving, count * sizeof(Card));
+        for (size_t i=0; i<count; ++i) {
+            game->locations[moving[i].number].pile_id = target_id;
+            game->locations[moving[i].number].depth   = base + i;
+        }
+    }
+
+    CardLocation LocateCard(const Game *game, int number)
+    {
+        CardLocation location = game->locations[number];
+        if (location.pile_id >= 0 && location.pile_id == game->variant->deck_id) {
+            if ((size_t) location.depth < game->stock.split) {
+                location.pile_id = game->variant->poll_id;
+            } else {
+                location.depth -= game->stock.split;
+            }
+        }
+        return location;
+    }
+
+    bool IsGameFinished(const Game *game)
+    {
+        size_t collected = 0;
+        for (int i=0; i<game->variant->foundations; ++i) {
+            collected += game->piles[FOUNDATION_ID(game, i)].size;
+        }
+        return collected == game->card_count;
+    }
+
+    /* Sets up the empty piles of a variant and their roles, without any card. */
+    void GameLayout(Game *game, const Variant *variant)
+    {
+        memset(game, 0, sizeof(Game));
+        game->variant    = variant;
+        game->pile_count = variant->first_column + variant->columns;
+        game->card_count = 52 * variant->decks;
+        for (int i=0; i<variant->foundations; ++i) {
+            game->infos[variant->first_foundation + i] = (PileInfo) { ROLE_FOUNDATION, i, variant->foundation_slot + i };
+        }
+        for (int i=0; i<variant->cells; ++i) {
+            game->infos[variant->first_cell + i] = (PileInfo) { ROLE_CELL, i, variant->cell_slot + i };
+        }
+        if (variant->poll_id >= 0) {
+            game->infos[variant->poll_id] = (PileInfo) { ROLE_POLL, 0, variant->poll_slot };
+        }
+        if (variant->deck_id >= 0) {
+            game->infos[variant->deck_id] = (PileInfo) { ROLE_DECK, 0, variant->deck_slot };
+        }
+        for (int i=0; i<variant->columns; ++i) {
+            game->infos[variant->first_column + i] = (PileInfo) { ROLE_COLUMN, i, i };
+        }
+    }
+
+    void GameInit(Game *game, const Variant *variant, unsigned int seed, size_t draw_count)
+    {
+        GameLayout(game, variant);
+        srand(seed);
+        Card deck[MAX_CARDS];
+        size_t size = game->card_count;
+        for (size_t i=0; i<size; ++i) {
+            Card card = { .number = i, .hidden = true };
+            deck[i]   = card;
+        }
+        for (size_t i=0; i<size; ++i) {
+            int rand_index = rand() % size;
+            Card tmp = deck[i];
+            deck[i] = deck[rand_index];
+            deck[rand_index] = tmp;
+        }
+        game->stock.draw_count = draw_count;
+        variant->deal(game, deck, size);
+    }
+
+    const char *PileEmptyMessage(PileRole role)
+    {
+        switch (role) {
+            case ROLE_FOUNDATION: return "That foundation pile is empty!";
+            case ROLE_CELL:       return "That cell is empty!";
+            case ROLE_POLL:       return "Poll is empty!";
+            case ROLE_DECK:       return "Deck is empty!";
+            default:              return "That column is empty!";
+        }
+    }
+
+    const char *DeadPatternMessage(DeadPattern pattern)
+    {
+        switch (pattern) {
+            case DEAD_NO_MOVES:       return "No card can ever be moved";
+            case DEAD_SELF_BLOCKED:   return "A card is buried over its parents and a lower card of its suit";
+            case DEAD_BLOCKING_CYCLE: return "Buried cards in different columns block each other";
+            default:                  return "No pattern found";
+        }
+    }
+
+    #define STACK_ALTERNATE_COLORS 0
+    #define STACK_ANY_SUIT         1
+
+    #define RUN_FACE_UP            0
+    #define RUN_ALTERNATE_COLORS   1
+    #define RUN_SAME_SUIT          2
+
+    #define EMPTY_BASE_RANK        0
+    #define EMPTY_ANY              1
+
+    #define BUILD_DOWN             (-1)
+    #define BUILD_UP               1
+
+    #define STOCK_NONE             0
+    #define STOCK_POLL             1
+    #define STOCK_DEAL_ROW         2
+
+    #define COLLECT_CARDS          0
+    #define COLLECT_RUNS           1
+
+    #define DEAL_KLONDIKE          0
+    #define DEAL_ALL               1
+    #define DEAL_SPIDER            2
+
+    #define VARIANT                   Klondike
+    #define VARIANT_NAME              "klondike"
+    #define VARIANT_COLUMNS           7
+    #define VARIANT_FOUNDATIONS       4
+    #define VARIANT_CELLS             0
+    #define VARIANT_DECKS             1
+    #define VARIANT_STACKING          STACK_ALTERNATE_COLORS
+    #define VARIANT_RUNS              RUN_FACE_UP
+    #define VARIANT_EMPTY             EMPTY_BASE_RANK
+    #define VARIANT_BUILD             BUILD_DOWN
+    #define VARIANT_STOCK             STOCK_POLL
+    #define VARIANT_COLLECT           COLLECT_CARDS
+    #define VARIANT_DEAL              DEAL_KLONDIKE
+    #define VARIANT_FOUNDATION_RETURN 1
+    #define VARIANT_FIRST_FOUNDATION  0
+    #define VARIANT_FIRST_CELL        -1
+    #define VARIANT_POLL              4
+    #define VARIANT_DECK              5
+    #define VARIANT_FIRST_COLUMN      6
+    #define VARIANT_FOUNDATION_SLOT   0
+    #define VARIANT_CELL_SLOT         -1
+    #define VARIANT_POLL_SLOT         5
+    #define VARIANT_DECK_SLOT         6
+    #include "stb_solitaire_rules.h"
+
+    #define VARIANT                   FreeCell
+    #define VARIANT_NAME              "freecell"
+    #define VARIANT_COLUMNS           8
+    #define VARIANT_FOUNDATIONS       4
+    #define VARIANT_CELLS             4
+    #define VARIANT_DECKS             1
+    #define VARIANT_STACKING          STACK_ALTERNATE_COLORS
+    #define VARIANT_RUNS              RUN_ALTERNATE_COLORS
+    #define VARIANT_EMPTY             EMPTY_ANY
+    #define VARIANT_BUILD             BUILD_DOWN
+    #define VARIANT_STOCK             STOCK_NONE
+    #define VARIANT_COLLECT           COLLECT_CARDS
+    #define VARIANT_DEAL              DEAL_ALL
+    #define VARIANT_FOUNDATION_RETURN 1
+    #define VARIANT_FIRST_FOUNDATION  4
+    #define VARIANT_FIRST_CELL        0
+    #define VARIANT_POLL              -1
+    #define VARIANT_DECK              -1
+    #define VARIANT_FIRST_COLUMN      8
+    #define VARIANT_FOUNDATION_SLOT   4
+    #define VARIANT_CELL_SLOT         0
+    #define VARIANT_POLL_SLOT         -1
+    #define VARIANT_DECK_SLOT         -1
+    #include "stb_solitaire_rules.h"
+
+    #define VARIANT                   Spider
+    #define VARIANT_NAME              "spider"
+    #define VARIANT_COLUMNS           10
+    #define VARIANT_FOUNDATIONS       8
+    #define VARIANT_CELLS             0
+    #define VARIANT_DECKS             2
+    #define VARIANT_STACKING          STACK_ANY_SUIT
+    #define VARIANT_RUNS              RUN_SAME_SUIT
+    #define VARIANT_EMPTY             EMPTY_ANY
+    #define VARIANT_BUILD             BUILD_DOWN
+    #define VARIANT_STOCK             STOCK_DEAL_ROW
+    #define VARIANT_COLLECT           COLLECT_RUNS
+    #define VARIANT_DEAL              DEAL_SPIDER
+    #define VARIANT_FOUNDATION_RETURN 0
+    #define VARIANT_FIRST_FOUNDATION  1
+    #define VARIANT_FIRST_CELL        -1
+    #define VARIANT_POLL              -1
+    #define VARIANT_DECK              0
+    #define VARIANT_FIRST_COLUMN      9
+    #define VARIANT_FOUNDATION_SLOT   2
+    #define VARIANT_CELL_SLOT         -1
+    #define VARIANT_POLL_SLOT         -1
+    #define VARIANT_DECK_SLOT         0
+    #include "stb_solitaire_rules.h"
+
+#ifdef SOLITAIRE_DECK_TEST
+#if MAX_DECKS < 3
+#error "SOLITAIRE_DECK_TEST needs MAX_DECKS of 3 or more"
+#endif
+    /* Spider with MAX_DECKS decks, so the checkers can play games with more than two decks. The board has no
+     * room for its foundations, it is not meant to be played. */
+    #define VARIANT                   BigSpider
+    #define VARIANT_NAME              "bigspider"
+    #define VARIANT_COLUMNS           10
+    #define VARIANT_FOUNDATIONS       (4 * MAX_DECKS)
+    #define VARIANT_CELLS             0
+    #define VARIANT_DECKS             MAX_DECKS
+    #define VARIANT_STACKING          STACK_ANY_SUIT
+    #define VARIANT_RUNS              RUN_SAME_SUIT
+    #define VARIANT_EMPTY             EMPTY_ANY
+    #define VARIANT_BUILD             BUILD_DOWN
+    #define VARIANT_STOCK             STOCK_DEAL_ROW
+    #define VARIANT_COLLECT           COLLECT_RUNS
+    #define VARIANT_DEAL              DEAL_SPIDER
+    #define VARIANT_FOUNDATION_RETURN 0
+    #define VARIANT_FIRST_FOUNDATION  1
+    #define VARIANT_FIRST_CELL        -1
+    #define VARIANT_POLL              -1
+    #define VARIANT_DECK              0
+    #define VARIANT_FIRST_COLUMN      (1 + 4 * MAX_DECKS)
+    #define VARIANT_FOUNDATION_SLOT   2
+    #define VARIANT_CELL_SLOT         -1
+    #define VARIANT_POLL_SLOT         -1
+    #define VARIANT_DECK_SLOT         0
+    #include "stb_solitaire_rules.h"
+#endif
+
+    const Variant *variants[]    = {
+        &KlondikeVariant, &FreeCellVariant, &SpiderVariant,
+#ifdef SOLITAIRE_DECK_TEST
+        &BigSpiderVariant,
+#endif
+    };
+    const size_t   variant_count = sizeof(variants) / sizeof(variants[0]);
+
+    const Variant *FindVariant(const char *name)
+    {
+        for (size_t i=0; i<variant_count; ++i) {
+            if (strcmp(variants[i]->name, name) == 0) {
+                return variants[i];
+            }
+        }
+        return NULL;
+    }
+
+    /* A game log is a text header naming the deal followed by one line per applied move, enough to replay the
+     * game with GameInit and apply_move. An "undo" line takes back the last move. */
+    FILE *GameLogOpen(const char *path, const Game *game, unsigned int seed)
+    {
+        FILE *log = fopen(path, "w");
+        if (log == NULL) {
+            fprintf(stderr, "%s:%d: Couldn't open %s\n", __FILE__, __LINE__, path);
+            return NULL;
+        }
+        fprintf(log, "%s %d %s %zu %u\n", GAME_LOG_MAGIC, GAME_LOG_VERSION, game->variant->name, game->stock.draw_count, seed);
+        return log;
+    }
+
+    void GameLogMove(FILE *log, Move move)
+    {
+        if (log != NULL) {
+            fprintf(log, "%d %d %d %d\n", move.kind, move.source, move.depth, move.target);
+            fflush(log);
+        }
+    }
+
+    void GameLogUndo(FILE *log)
+    {
+        if (log != NULL) {
+            fprintf(log, "undo\n");
+            fflush(log);
+        }
+    }
+
+    /* Returns the moves of the log with undone moves left out, to be freed by the caller, or NULL if it cannot be
+     * read. */
+    Move *GameLogLoad(const char *path, const Variant **variant, unsigned int *seed, size_t *draw_count, size_t *move_count)
+    {
+        FILE *log = fopen(path, "r");
+        if (log == NULL) {
+            fprintf(stderr, "%s:%d: Couldn't open %s\n", __FILE__, __LINE__, path);
+            return NULL;
+        }
+        char magic[32], name[32];
+        int  version;
+        if (fscanf(log, "%31s %d %31s %zu %u", magic, &version, name, draw_count, seed) != 5 ||
+            strcmp(magic, GAME_LOG_MAGIC) != 0 || version != GAME_LOG_VERSION || (*variant = FindVariant(name)) == NULL
+        ) {
+            fprintf(stderr, "%s:%d: %s is not a game log\n", __FILE__, __LINE__, path);
+            fclose(log);
+            return NULL;
+        }
+        size_t capacity = 256;
+        Move  *moves    = malloc(capacity * sizeof(Move));
+        char   line[64];
+        int    kind, source, depth, target;
+        *move_count = 0;
+        while (moves != NULL && fgets(line, sizeof(line), log) != NULL) {
+            if (strncmp(line, "undo", 4) == 0) {
+                *move_count -= *move_count > 0;
+                continue;
+            }
+            if (sscanf(line, "%d %d %d %d", &kind, &source, &depth, &target) != 4) {
+                continue;
+            }
+            if (*move_count == capacity) {
+                capacity *= 2;
+                Move *grown = realloc(moves, capacity * sizeof(Move));
+                if (grown == NULL) {
+                    free(moves);
+                    moves = NULL;
+                    break;
+                }
+                moves = grown;
+            }
+            moves[(*move_count)++] = (Move) { .kind = kind, .source = source, .depth = depth, .target = target };
+        }
+        fclose(log);
+        return moves;
+    }
+
+    uint8_t *SnapshotPut(uint8_t *at, uint32_t value, int bytes)
+    {
+        for (int i=0; i<bytes; ++i) {
+            *at++ = value >> (8 * i);
+        }
+        return at;
+    }
+
+    uint32_t SnapshotGet(const uint8_t **at, int bytes)
+    {
+        uint32_t value = 0;
+        for (int i=0; i<bytes; ++i) {
+            value |= (uint32_t) *(*at)++ << (8 * i);
+        }
+        return value;
+    }
+
+    /* FNV-1a, the same hash the races compare games with. */
+    uint32_t SnapshotChecksum(const uint8_t *buffer, size_t size)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i=0; i<size; ++i) {
+            hash = (hash ^ buffer[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    /* A snapshot is a little-endian header naming the deal, the turn and move counts, then the size and cards of
+     * every pile, the stock with the split its draw cycle started from and how far the cycle has gone, the moves
+     * played so far and a checksum of all of it. A card takes two bytes and a move four. Writes at most
+     * GAME_SNAPSHOT_SIZE(move_count) bytes to `buffer` and returns how many. */
+    size_t GameSnapshotEncode(const Game *game, unsigned int seed, int turns, const Move moves[], size_t move_count, uint8_t *buffer)
+    {
+        const Variant *variant = game->variant;
+        uint8_t       *at      = buffer;
+        size_t         index   = 0;
+        for (size_t i=0; i<variant_count; ++i) {
+            index = variants[i] == variant ? i : index;
+        }
+        at = SnapshotPut(at, GAME_SNAPSHOT_MAGIC, 4);
+        at = SnapshotPut(at, GAME_SNAPSHOT_VERSION, 1);
+        at = SnapshotPut(at, index, 1);
+        at = SnapshotPut(at, game->stock.draw_count, 1);
+        at = SnapshotPut(at, game->pile_count, 1);
+        at = SnapshotPut(at, seed, 4);
+        at = SnapshotPut(at, turns, 4);
+        at = SnapshotPut(at, move_count, 4);
+        for (int i=0; i<game->pile_count; ++i) {
+            if (i == variant->poll_id || i == variant->deck_id) {
+                continue;
+            }
+            at = SnapshotPut(at, game->piles[i].size, 2);
+            for (size_t j=0; j<game->piles[i].size; ++j) {
+                at = SnapshotPut(at, PILE_CARDS(game, i)[j].number << 1 | PILE_CARDS(game, i)[j].hidden, 2);
+            }
+        }
+        at = SnapshotPut(at, game->stock.size, 2);
+        at = SnapshotPut(at, game->stock.stops[0], 2);
+        at = SnapshotPut(at, game->stock.cursor, 2);
+        for (size_t i=0; i<game->stock.size; ++i) {
+            at = SnapshotPut(at, STOCK_CARDS(game)[i].number << 1 | STOCK_CARDS(game)[i].hidden, 2);
+        }
+        for (size_t i=0; i<move_count; ++i) {
+            at = SnapshotPut(at, moves[i].kind, 1);
+            at = SnapshotPut(at, (uint8_t) moves[i].source, 1);
+            at = SnapshotPut(at, moves[i].depth, 1);
+            at = SnapshotPut(at, (uint8_t) moves[i].target, 1);
+        }
+        at = SnapshotPut(at, SnapshotChecksum(buffer, at - buffer), 4);
+        return at - buffer;
+    }
+
+    /* Reads a card of a snapshot into `card` and records where it is. Returns false if the card is not part of
+     * the game or was already placed. */
+    bool SnapshotCard(const uint8_t **at, Game *game, bool placed[], int pile_id, size_t depth, Card *card)
+    {
+        uint32_t value = SnapshotGet(at, 2);
+        *card = (Card) { .number = value >> 1, .hidden = value & 1 };
+        if ((size_t) card->number >= game->card_count || placed[card->number]) {
+            return false;
+        }
+        placed[card->number] = true;
+        game->locations[card->number] = (CardLocation) { .pile_id = pile_id, .depth = depth };
+        return true;
+    }
+
+    /* Rebuilds the game of a snapshot without replaying its moves or dealing. Returns the moves, to be freed by the
+     * caller, or NULL if the snapshot is cut short, fails its checksum or was written by another version, in which
+     * case `game` and the counts are left untouched. */
+    Move *GameSnapshotDecode(const uint8_t *buffer, size_t size, Game *game, unsigned int *seed, int *turns, size_t *move_count)
+    {
+        const uint8_t *at = buffer;
+        if (size < 24 || SnapshotGet(&at, 4) != GAME_SNAPSHOT_MAGIC || SnapshotGet(&at, 1) != GAME_SNAPSHOT_VERSION) {
+            return NULL;
+        }
+        const uint8_t *end      = buffer + size - 4;
+        const uint8_t *checksum = end;
+        if (SnapshotGet(&checksum, 4) != SnapshotChecksum(buffer, size - 4)) {
+            return NULL;
+        }
+        size_t       variant_idx    = SnapshotGet(&at, 1);
+        size_t       draw_count     = SnapshotGet(&at, 1);
+        int          pile_count     = SnapshotGet(&at, 1);
+        unsigned int snapshot_seed  = SnapshotGet(&at, 4);
+        int          snapshot_turns = SnapshotGet(&at, 4);
+        size_t       snapshot_count = SnapshotGet(&at, 4);
+        if (variant_idx >= variant_count || draw_count == 0) {
+            return NULL;
+        }
+        const Variant *variant = variants[variant_idx];
+        bool           placed[MAX_CARDS] = {0};
+        size_t         offset = 0;
+        Game           decoded;
+        GameLayout(&decoded, variant);
+        decoded.stock.draw_count = draw_count;
+        if (pile_count != decoded.pile_count) {
+            return NULL;
+        }
+        for (int i=0; i<pile_count; ++i) {
+            decoded.piles[i] = (Pile) { .offset = offset, .size = 0 };
+            if (i == variant->poll_id || i == variant->deck_id) {
+                continue;
+            }
+            if (end - at < 2) {
+                return NULL;
+            }
+            decoded.piles[i].size = SnapshotGet(&at, 2);
+            if (offset + decoded.piles[i].size > decoded.card_count || (size_t) (end - at) < 2 * decoded.piles[i].size) {
+                return NULL;
+            }
+            for (size_t j=0; j<decoded.piles[i].size; ++j) {
+                if (!SnapshotCard(&at, &decoded, placed, i, j, &decoded.cards[offset + j])) {
+                    return NULL;
+                }
+            }
+            offset += decoded.piles[i].size;
+        }
+        if (end - at < 6) {
+            return NULL;
+        }
+        Stock *stock  = &decoded.stock;
+        stock->offset = offset;
+        stock->size   = SnapshotGet(&at, 2);
+        stock->split  = SnapshotGet(&at, 2);
+        size_t cursor = SnapshotGet(&at, 2);
+        if (offset + stock->size != decoded.card_count || stock->split > stock->size || (size_t) (end - at) < 2 * stock->size) {
+            return NULL;
+        }
+        for (size_t i=0; i<stock->size; ++i) {
+            if (!SnapshotCard(&at, &decoded, placed, variant->deck_id, i, &decoded.cards[offset + i])) {
+                return NULL;
+            }
+        }
+        if (variant->deck_id >= 0) {  /* Variants without a stock have no draw cycle */
+            StockPlanCycle(stock);
+        }
+        if (cursor >= (stock->stop_count > 0 ? stock->stop_count : 1) || (size_t) (end - at) != 4 * snapshot_count) {
+            return NULL;
+        }
+        if (stock->stop_count > 0) {
+            stock->cursor = cursor;
+            stock->split  = stock->stops[cursor];
+        }
+
+        Move *moves = malloc((snapshot_count + 1) * sizeof(Move));
+        if (moves == NULL) {
+            return NULL;
+        }
+        for (size_t i=0; i<snapshot_count; ++i) {
+            moves[i].kind   = SnapshotGet(&at, 1);
+            moves[i].source = (int8_t) SnapshotGet(&at, 1);
+            moves[i].depth  = SnapshotGet(&at, 1);
+            moves[i].target = (int8_t) SnapshotGet(&at, 1);
+        }
+        *game       = decoded;
+        *seed       = snapshot_seed;
+        *turns      = snapshot_turns;
+        *move_count = snapshot_count;
+        return moves;
+    }
+#endif // STB_SOLITAIRE_IMPLEMENTATION
@@ -0,0 +1,563 @@
+/* Rules of one solitaire variant. stb_solitaire.h includes this file once per variant after defining the VARIANT_*
+ * constants, so every check below is resolved by the preprocessor or folded by the compiler and each variant gets
+ * its own move generator. There is deliberately no include guard. */
+
+#define VARIANT_FN(name)      VARIANT_CONCAT(VARIANT, name)
+#define VARIANT_CONCAT(a, b)  VARIANT_CONCAT_(a, b)
+#define VARIANT_CONCAT_(a, b) a##b
+#define VARIANT_PILE_COUNT    (VARIANT_FIRST_COLUMN + VARIANT_COLUMNS)
+#define VARIANT_BASE_RANK     (VARIANT_BUILD == BUILD_DOWN ? 12 : 0)
+
+#if VARIANT_DECKS < 1 || VARIANT_DECKS > MAX_DECKS
+#error "VARIANT_DECKS must be between 1 and MAX_DECKS"
+#endif
+
+static inline bool VARIANT_FN(CanStack)(Card moving, Card under)
+{
+#if VARIANT_STACKING == STACK_ALTERNATE_COLORS
+    return RANK_OF(moving) == RANK_OF(under) + VARIANT_BUILD && COLOR_OF(moving) != COLOR_OF(under);
+#else
+    return RANK_OF(moving) == RANK_OF(under) + VARIANT_BUILD;
+#endif
+}
+
+/* Whether the cards from `depth` to the top of a column can be picked up together. */
+static inline bool VARIANT_FN(IsRun)(const Game *game, int column_id, size_t depth)
+{
+    const Card *cards = PILE_CARDS(game, column_id);
+#if VARIANT_RUNS != RUN_FACE_UP
+    for (size_t i=depth+1; i<game->piles[column_id].size; ++i) {
+#if VARIANT_RUNS == RUN_SAME_SUIT
+        if (SUITE_OF(cards[i]) != SUITE_OF(cards[i-1]) || RANK_OF(cards[i]) != RANK_OF(cards[i-1]) + VARIANT_BUILD) {
+            return false;
+        }
+#else
+        if (!VARIANT_FN(CanStack)(cards[i], cards[i-1])) {
+            return false;
+        }
+#endif
+    }
+#endif
+    return !cards[depth].hidden;
+}
+
+#if VARIANT_RUNS == RUN_ALTERNATE_COLORS
+/* Longest run that can be moved one card at a time through the free cells and empty columns. */
+static inline size_t VARIANT_FN(MaxRun)(const Game *game, int target_id)
+{
+    size_t free_cells = 0, empty_columns = 0;
+    for (int i=0; i<VARIANT_CELLS; ++i) {
+        free_cells += game->piles[VARIANT_FIRST_CELL + i].size == 0;
+    }
+    for (int i=0; i<VARIANT_COLUMNS; ++i) {
+        empty_columns += game->piles[VARIANT_FIRST_COLUMN + i].size == 0 && VARIANT_FIRST_COLUMN + i != target_id;
+    }
+    return (free_cells + 1) << empty_columns;
+}
+#endif
+
+#if VARIANT_COLLECT == COLLECT_RUNS
+/* Moves a finished suit from the top of a column onto the first empty foundation. */
+static void VARIANT_FN(CollectRun)(Game *game, int column_id)
+{
+    size_t size = game->piles[column_id].size;
+    if (size < 13 || RANK_OF(LAST_NTH_CARD_OF(game, column_id, 13)) != VARIANT_BASE_RANK ||
+        !VARIANT_FN(IsRun)(game, column_id, size - 13)
+    ) {
+        return;
+    }
+    for (int i=0; i<VARIANT_FOUNDATIONS; ++i) {
+        if (game->piles[VARIANT_FIRST_FOUNDATION + i].size == 0) {
+            MoveCards(game, column_id, size - 13, VARIANT_FIRST_FOUNDATION + i);
+            if (size > 13) {
+                LAST_CARD_OF(game, column_id).hidden = false;
+            }
+            return;
+        }
+    }
+}
+#endif
+
+static void VARIANT_FN(Deal)(Game *game, Card deck[], size_t size)
+{
+#if VARIANT_DEAL == DEAL_KLONDIKE
+    for (int i=0; i<VARIANT_COLUMNS; ++i) {
+        for (int j=0; j<=i; ++j) {
+            PushCard(game, VARIANT_FIRST_COLUMN + i, deck[--size]);
+        }
+        LAST_CARD_OF(game, VARIANT_FIRST_COLUMN + i).hidden = false;
+    }
+#elif VARIANT_DEAL == DEAL_ALL
+    for (int i=0; size>0; ++i) {
+        Card card   = deck[--size];
+        card.hidden = false;
+        PushCard(game, VARIANT_FIRST_COLUMN + i % VARIANT_COLUMNS, card);
+    }
+#else
+    for (int i=0; i<54; ++i) {
+        PushCard(game, VARIANT_FIRST_COLUMN + i % VARIANT_COLUMNS, deck[--size]);
+    }
+    for (int i=0; i<VARIANT_COLUMNS; ++i) {
+        LAST_CARD_OF(game, VARIANT_FIRST_COLUMN + i).hidden = false;
+    }
+#endif
+#if VARIANT_STOCK != STOCK_NONE
+    StockInit(game, deck, size);
+#endif
+}
+
+/* Returns NULL if the move is legal, otherwise the reason it is not. */
+static const char *VARIANT_FN(CheckMove)(const Game *game, Move move)
+{
+    if (move.kind == MOVE_DRAW) {
+#if VARIANT_STOCK == STOCK_NONE
+        return "There is no deck in this game!";
+#elif VARIANT_STOCK == STOCK_DEAL_ROW
+        if (game->stock.size < VARIANT_COLUMNS) {
+            return "Deck is empty!";
+        }
+        for (int i=0; i<VARIANT_COLUMNS; ++i) {
+            if (game->piles[VARIANT_FIRST_COLUMN + i].size == 0) {
+                return "Fill every column before dealing!";
+            }
+        }
+        return NULL;
+#else
+        return NULL;
+#endif
+    }
+    if (move.source < 0 || move.source >= VARIANT_PILE_COUNT || move.target < 0 || move.target >= VARIANT_PILE_COUNT) {
+        return "Invalid pile!";
+    }
+    PileRole source_role = game->infos[move.source].role;
+    PileRole target_role = game->infos[move.target].role;
+    size_t   source_size = PileSize(game, move.source);
+    if (source_role == ROLE_DECK) {
+        return "Draw cards from the deck instead!";
+    }
+    if (source_size == 0) {
+        return PileEmptyMessage(source_role);
+    }
+    if (move.depth >= source_size) {
+        return "Card not found!";
+    }
+    if (move.source == move.target) {
+        return "Card is already there!";
+    }
+    Card   moving = PileCard(game, move.source, move.depth);
+    size_t count  = source_size - move.depth;
+    if (moving.hidden) {
+        return "That card is face down!";
+    }
+#if !VARIANT_FOUNDATION_RETURN
+    if (source_role == ROLE_FOUNDATION) {
+        return "Cards cannot leave the foundations!";
+    }
+#endif
+    if (source_role != ROLE_COLUMN && count != 1) {
+        return "Only the top card can be moved!";
+    }
+    if (source_role == ROLE_COLUMN && !VARIANT_FN(IsRun)(game, move.source, move.depth)) {
+        return "That sequence cannot be moved!";
+    }
+
+    const Pile *target = &game->piles[move.target];
+    switch (target_role) {
+        case ROLE_FOUNDATION: {
+#if VARIANT_COLLECT == COLLECT_CARDS
+            if (count != 1) {
+                return "Only the top card can be collected!";
+            }
+            if (!(game->infos[move.target].ordinal % 4 == SUITE_OF(moving) && (
+                (target->size == 0 && RANK_OF(moving) == 0) ||
+                (target->size > 0  && RANK_OF(moving) == RANK_OF(LAST_CARD_OF(game, move.target)) + 1)
+            ))) {
+                return "Ranks not matching!";
+            }
+#else
+            if (target->size > 0) {
+                return "That foundation pile is full!";
+            }
+            if (count != 13 || RANK_OF(moving) != VARIANT_BASE_RANK) {
+                return "Only complete suits can be collected!";
+            }
+#endif
+            return NULL;
+        }
+        case ROLE_CELL: {
+            if (target->size > 0) {
+                return "That cell is occupied!";
+            }
+            if (count != 1) {
+                return "Only single cards fit in a cell!";
+            }
+            return NULL;
+        }
+        case ROLE_COLUMN: {
+            if (target->size == 0) {
+#if VARIANT_EMPTY == EMPTY_BASE_RANK
+                if (RANK_OF(moving) != VARIANT_BASE_RANK) {
+                    return "Ranks or Suites not matching!";
+                }
+#endif
+            } else if (!VARIANT_FN(CanStack)(moving, LAST_CARD_OF(game, move.target))) {
+                return "Ranks or Suites not matching!";
+            }
+#if VARIANT_RUNS == RUN_ALTERNATE_COLORS
+            if (count > VARIANT_FN(MaxRun)(game, move.target)) {
+                return "Not enough free cells to move that sequence!";
+            }
+#endif
+            return NULL;
+        }
+        default: {
+            return "You can only move cards to column piles!";
+        }
+    }
+}
+
+/* Lists every legal move. Moves onto an empty cell or column are only listed for the first such pile. */
+static size_t VARIANT_FN(GenerateMoves)(const Game *game, Move moves[])
+{
+    size_t count = 0;
+#if VARIANT_STOCK != STOCK_NONE
+    Move draw = { .kind = MOVE_DRAW, .source = VARIANT_DECK, .target = VARIANT_DECK };
+    if (game->stock.size > 0 && VARIANT_FN(CheckMove)(game, draw) == NULL) {
+        moves[count++] = draw;
+    }
+#endif
+    for (int source=0; source<VARIANT_PILE_COUNT; ++source) {
+        size_t size = PileSize(game, source);
+        if (size == 0 || game->infos[source].role == ROLE_DECK) {
+            continue;
+        }
+        for (size_t depth = game->infos[source].role == ROLE_COLUMN ? 0 : size - 1; depth<size; ++depth) {
+            if (PileCard(game, source, depth).hidden) {
+                continue;
+            }
+            bool tried_empty_cell = false, tried_empty_column = false;
+            for (int target=0; target<VARIANT_PILE_COUNT && count<MAX_MOVES; ++target) {
+                PileRole role = game->infos[target].role;
+                bool empty    = game->piles[target].size == 0;
+                if ((role == ROLE_CELL && empty && tried_empty_cell) || (role == ROLE_COLUMN && empty && tried_empty_column)) {
+                    continue;
+                }
+                Move move = { .kind = MOVE_CARDS, .source = source, .depth = depth, .target = target };
+                if (VARIANT_FN(CheckMove)(game, move) == NULL) {
+                    moves[count++] = move;
+                    tried_empty_cell   |= role == ROLE_CELL   && empty;
+                    tried_empty_column |= role == ROLE_COLUMN && empty;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+/* Applies a legal move. Returns false when the move does not count as a turn, which is only recycling the poll. */
+static bool VARIANT_FN(ApplyMove)(Game *game, Move move)
+{
+    if (move.kind == MOVE_DRAW) {
+#if VARIANT_STOCK == STOCK_POLL
+        if (StockDraw(&game->stock) == 0) {
+            StockRecycle(&game->stock);
+            return false;
+        }
+        return true;
+#elif VARIANT_STOCK == STOCK_DEAL_ROW
+        for (int i=0; i<VARIANT_COLUMNS; ++i) {
+            PushCard(game, VARIANT_FIRST_COLUMN + i, StockPop(game));
+        }
+        for (int i=0; i<VARIANT_COLUMNS; ++i) {
+            VARIANT_FN(CollectRun)(game, VARIANT_FIRST_COLUMN + i);
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+#if VARIANT_POLL >= 0
+    if (move.source == VARIANT_POLL) {
+        PushCard(game, move.target, StockTake(game));
+    } else
+#endif
+    MoveCards(game, move.source, move.depth, move.target);
+    if (move.source >= VARIANT_FIRST_COLUMN && game->piles[move.source].size > 0) {
+        LAST_CARD_OF(game, move.source).hidden = false;
+    }
+#if VARIANT_COLLECT == COLLECT_RUNS
+    if (move.target >= VARIANT_FIRST_COLUMN) {
+        VARIANT_FN(CollectRun)(game, move.target);
+    }
+#endif
+    return true;
+}
+
+/* The move that sends the top of `source` to the foundations, to be checked like any other move. */
+static Move VARIANT_FN(CollectMove)(const Game *game, int source)
+{
+    size_t size = PileSize(game, source);
+    Move   move = { .kind = MOVE_CARDS, .source = source, .target = VARIANT_FIRST_FOUNDATION };
+#if VARIANT_COLLECT == COLLECT_CARDS
+    move.depth = size > 0 ? size - 1 : 0;
+    if (size > 0) {
+        int suite   = SUITE_OF(PileCard(game, source, size - 1));
+        move.target = VARIANT_FIRST_FOUNDATION + suite;
+        for (int i=suite; i<VARIANT_FOUNDATIONS; i+=4) {
+            Move copy   = move;
+            copy.target = VARIANT_FIRST_FOUNDATION + i;
+            if (VARIANT_FN(CheckMove)(game, copy) == NULL) {
+                return copy;
+            }
+        }
+    }
+#else
+    move.depth = size > 13 ? size - 13 : 0;
+    for (int i=VARIANT_FOUNDATIONS-1; i>=0; --i) {
+        if (game->piles[VARIANT_FIRST_FOUNDATION + i].size == 0) {
+            move.target = VARIANT_FIRST_FOUNDATION + i;
+        }
+    }
+#endif
+    return move;
+}
+
+/* Finds a move to the foundations that can never hurt: no card left in play could need the collected card to
+ * stack on. Only columns and cells are considered, taking from the poll would shift the cards left to draw. */
+static bool VARIANT_FN(FindSafeMove)(const Game *game, Move *move)
+{
+#if VARIANT_COLLECT == COLLECT_CARDS && VARIANT_STACKING == STACK_ALTERNATE_COLORS && VARIANT_DECKS == 1
+    for (int source=0; source<VARIANT_PILE_COUNT; ++source) {
+        PileRole role = game->infos[source].role;
+        if ((role != ROLE_COLUMN && role != ROLE_CELL) || game->piles[source].size == 0) {
+            continue;
+        }
+        Card card     = LAST_CARD_OF(game, source);
+        int  opposite = (1 - COLOR_OF(card)) * 2;
+        if (RANK_OF(card) > 1 && (
+            (int) game->piles[VARIANT_FIRST_FOUNDATION + opposite].size     < RANK_OF(card) ||
+            (int) game->piles[VARIANT_FIRST_FOUNDATION + opposite + 1].size < RANK_OF(card)
+        )) {
+            continue;
+        }
+        *move = VARIANT_FN(CollectMove)(game, source);
+        if (VARIANT_FN(CheckMove)(game, *move) == NULL) {
+            return true;
+        }
+    }
+#else
+    (void) game;
+    (void) move;
+#endif
+    return false;
+}
+
+#if VARIANT_EMPTY == EMPTY_BASE_RANK && VARIANT_CELLS == 0
+/* Depth of the card in the column if it is there, -1 otherwise. */
+static int VARIANT_FN(DepthIn)(const Game *game, int number, int column_id)
+{
+    return game->locations[number].pile_id == column_id ? game->locations[number].depth : -1;
+}
+
+/* A card is pinned when it is face down or the lowest face-up card of its column, and every card it could be
+ * stacked on lies beneath it. Nothing under it can be reached before it leaves, and the only way left for it
+ * is the foundation. Kings are never pinned since they can move to an empty column. */
+static bool VARIANT_FN(IsPinned)(const Game *game, int column_id, size_t depth)
+{
+    const Card *cards = PILE_CARDS(game, column_id);
+    Card        card  = cards[depth];
+    if (RANK_OF(card) == VARIANT_BASE_RANK || (!card.hidden && depth > 0 && !cards[depth - 1].hidden)) {
+        return false;
+    }
+    for (size_t number=0; number<game->card_count; ++number) {
+        Card parent = { .number = number };
+        int  under  = VARIANT_FN(DepthIn)(game, number, column_id);
+        if (VARIANT_FN(CanStack)(card, parent) && (under < 0 || under > (int) depth)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Finds a pinned card the pinned card `number` waits for: one sitting above every copy of a lower card of its
+ * suit that is not collected yet. Returns -1 if there is none. */
+static int VARIANT_FN(PinnedBlocker)(const Game *game, const bool pinned[], int number, int skip)
+{
+    Card card = { .number = number };
+    for (int rank=0; rank<RANK_OF(card); ++rank) {
+        int column_id = -1, deepest = -1;
+        for (int deck=0; deck<VARIANT_DECKS; ++deck) {
+            int copy = deck * 52 + SUITE_OF(card) * 13 + rank;
+            int pile = game->locations[copy].pile_id;
+            if (pile >= VARIANT_FIRST_FOUNDATION && pile < VARIANT_FIRST_FOUNDATION + VARIANT_FOUNDATIONS) {
+                continue;
+            }
+            if (pile < VARIANT_FIRST_COLUMN || (column_id != -1 && column_id != pile)) {
+                column_id = -2;
+                break;
+            }
+            column_id = pile;
+            deepest   = game->locations[copy].depth > deepest ? game->locations[copy].depth : deepest;
+        }
+        if (column_id < 0) {
+            continue;
+        }
+        for (size_t depth=deepest+1; depth<game->piles[column_id].size; ++depth) {
+            int blocker = PILE_CARDS(game, column_id)[depth].number;
+            if (pinned[blocker] && skip-- == 0) {
+                return blocker;
+            }
+        }
+    }
+    return -1;
+}
+
+/* Depth first search for a cycle of pinned cards each waiting for the next. */
+static int VARIANT_FN(FindPinnedCycle)(const Game *game, const bool pinned[], uint8_t state[], int number)
+{
+    state[number] = 1;
+    int blocker;
+    for (int i=0; (blocker = VARIANT_FN(PinnedBlocker)(game, pinned, number, i)) != -1; ++i) {
+        if (state[blocker] == 1) {
+            return blocker;
+        }
+        if (state[blocker] == 0) {
+            int found = VARIANT_FN(FindPinnedCycle)(game, pinned, state, blocker);
+            if (found != -1) {
+                return found;
+            }
+        }
+    }
+    state[number] = 2;
+    return -1;
+}
+#endif
+
+/* The structural part of FindDeadPattern: buried cards that block themselves or each other. Needs no move
+ * generation, so the solver runs it on every position and leaves the rest to the moves it generates anyway. */
+static DeadPattern VARIANT_FN(FindDeadCycle)(const Game *game, int *card)
+{
+    if (card != NULL) {
+        *card = -1;
+    }
+    if (IsGameFinished(game)) {
+        return DEAD_NONE;
+    }
+#if VARIANT_EMPTY == EMPTY_BASE_RANK && VARIANT_CELLS == 0
+    bool pinned[MAX_CARDS] = {0};
+    bool any_pinned        = false;
+    for (int i=0; i<VARIANT_COLUMNS; ++i) {
+        const Card *cards = PILE_CARDS(game, VARIANT_FIRST_COLUMN + i);
+        for (size_t depth=0; depth<game->piles[VARIANT_FIRST_COLUMN + i].size; ++depth) {
+            pinned[cards[depth].number] = VARIANT_FN(IsPinned)(game, VARIANT_FIRST_COLUMN + i, depth);
+            any_pinned |= pinned[cards[depth].number];
+        }
+    }
+    uint8_t state[MAX_CARDS] = {0};
+    for (size_t number=0; number<game->card_count && any_pinned; ++number) {
+        if (!pinned[number] || state[number] != 0) {
+            continue;
+        }
+        int found = VARIANT_FN(FindPinnedCycle)(game, pinned, state, number);
+        if (found != -1) {
+            if (card != NULL) {
+                *card = found;
+            }
+            for (int i=0, blocker; (blocker = VARIANT_FN(PinnedBlocker)(game, pinned, found, i)) != -1; ++i) {
+                if (blocker == found) {
+                    return DEAD_SELF_BLOCKED;
+                }
+            }
+            return DEAD_BLOCKING_CYCLE;
+        }
+    }
+#endif
+    return DEAD_NONE;
+}
+
+/* Looks for structural patterns that make the position impossible to win. Only certain losses are reported, so
+ * DEAD_NONE does not mean the game can be won. `card`, if given, receives the card the pattern was found on. */
+static DeadPattern VARIANT_FN(FindDeadPattern)(const Game *game, int *card)
+{
+    DeadPattern pattern = VARIANT_FN(FindDeadCycle)(game, card);
+    if (pattern != DEAD_NONE || IsGameFinished(game)) {
+        return pattern;
+    }
+    /* Nothing but drawing is possible and a whole pass through the stock brings up no playable card. The game is
+     * only copied once it offers nothing but a draw. */
+    Game        copy;
+    const Game *position = game;
+    Move        moves[MAX_MOVES];
+    size_t      draws = VARIANT_STOCK == STOCK_POLL ? 2 * (game->stock.size + 1) : 0;
+    for (size_t i=0; i<=draws; ++i) {
+        size_t count = VARIANT_FN(GenerateMoves)(position, moves);
+        for (size_t j=0; j<count; ++j) {
+            if (moves[j].kind != MOVE_DRAW || VARIANT_STOCK != STOCK_POLL) {
+                return DEAD_NONE;
+            }
+        }
+        if (count == 0) {
+            break;
+        }
+        if (position == game) {
+            copy     = *game;
+            position = &copy;
+        }
+        VARIANT_FN(ApplyMove)(&copy, moves[0]);
+    }
+    return DEAD_NO_MOVES;
+}
+
+const Variant VARIANT_FN(Variant) = {
+    .name              = VARIANT_NAME,
+    .columns           = VARIANT_COLUMNS,
+    .foundations       = VARIANT_FOUNDATIONS,
+    .cells             = VARIANT_CELLS,
+    .decks             = VARIANT_DECKS,
+    .first_foundation  = VARIANT_FIRST_FOUNDATION,
+    .first_cell        = VARIANT_FIRST_CELL,
+    .first_column      = VARIANT_FIRST_COLUMN,
+    .poll_id           = VARIANT_POLL,
+    .deck_id           = VARIANT_DECK,
+    .foundation_slot   = VARIANT_FOUNDATION_SLOT,
+    .cell_slot         = VARIANT_CELL_SLOT,
+    .poll_slot         = VARIANT_POLL_SLOT,
+    .deck_slot         = VARIANT_DECK_SLOT,
+    .deal              = VARIANT_FN(Deal),
+    .check_move        = VARIANT_FN(CheckMove),
+    .generate_moves    = VARIANT_FN(GenerateMoves),
+    .apply_move        = VARIANT_FN(ApplyMove),
+    .collect_move      = VARIANT_FN(CollectMove),
+    .find_dead_pattern = VARIANT_FN(FindDeadPattern),
+    .find_dead_cycle   = VARIANT_FN(FindDeadCycle),
+    .find_safe_move    = VARIANT_FN(FindSafeMove),
+};
+
+#undef VARIANT_FN
+#undef VARIANT_CONCAT
+#undef VARIANT_CONCAT_
+#undef VARIANT_PILE_COUNT
+#undef VARIANT_BASE_RANK
+#undef VARIANT
+#undef VARIANT_NAME
+#undef VARIANT_COLUMNS
+#undef VARIANT_FOUNDATIONS
+#undef VARIANT_CELLS
+#undef VARIANT_DECKS
+#undef VARIANT_STACKING
+#undef VARIANT_RUNS
+#undef VARIANT_EMPTY
+#undef VARIANT_BUILD
+#undef VARIANT_STOCK
+#undef VARIANT_COLLECT
+#undef VARIANT_DEAL
+#undef VARIANT_FOUNDATION_RETURN
+#undef VARIANT_FIRST_FOUNDATION
+#undef VARIANT_FIRST_CELL
+#undef VARIANT_POLL
+#undef VARIANT_DECK
+#undef VARIANT_FIRST_COLUMN
+#undef VARIANT_FOUNDATION_SLOT
+#undef VARIANT_CELL_SLOT
+#undef VARIANT_POLL_SLOT
+#undef VARIANT_DECK_SLOT
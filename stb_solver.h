@@ -0,0 +1,550 @@
+#ifndef STB_SOLVER_H
+#define STB_SOLVER_H
+    #include <stddef.h>
+    #include <stdint.h>
+    #include <stdbool.h>
+    #include <stdatomic.h>
+    #include "stb_solitaire.h"
+
+    #define TABLE_BUCKET_ENTRIES 6
+    #define TABLE_MAX_EPOCH      0xffff
+    #define SOLVER_MAX_VIA       64
+
+    /* One cache line of positions. An entry is live when its epoch is the running search or a search that was
+     * proven lost, anything else is free to reuse. */
+    typedef struct TableBucket {
+        uint64_t keys[TABLE_BUCKET_ENTRIES];
+        uint16_t epochs[TABLE_BUCKET_ENTRIES];
+        uint8_t  victim;
+        uint8_t  reserved[3];
+    } TableBucket;
+
+    /* Positions already searched, in two tiers: a hot set-associative cache in RAM whose size bounds the memory
+     * used, and a bigger bucketed table in a memory-mapped file that takes whatever the cache evicts. When a disk
+     * bucket is full too an entry is dropped, which only costs searching that position again. */
+    typedef struct Table {
+        TableBucket *hot;
+        size_t       hot_count;
+        TableBucket *disk;
+        size_t       disk_count;
+        size_t       disk_bytes;
+        uint16_t     epoch;
+        uint8_t      proven[(TABLE_MAX_EPOCH + 1) / 8];
+        size_t       hot_hits;
+        size_t       disk_hits;
+        size_t       misses;
+        size_t       spills;
+        size_t       drops;
+        size_t       prefetches;
+    } Table;
+
+    Table   *TableOpen(size_t memory_bytes, const char *disk_path, size_t disk_bytes);
+    void     TableClose(Table *table);
+    void     TableBeginSearch(Table *table);
+    void     TableEndSearch(Table *table, bool proven_lost);
+    bool     TableSeen(Table *table, uint64_t key);
+    void     TableInsert(Table *table, uint64_t key);
+    void     TablePrefetch(Table *table, const uint64_t keys[], size_t count);
+
+    typedef enum SolveResult {
+        SOLVE_WON,
+        SOLVE_LOST,
+        SOLVE_UNKNOWN,
+    } SolveResult;
+
+    /* `solution` holds the moves of the last won search, safe moves to the foundations included. A search gives
+     * up as unknown once `cancel`, if given, is set. */
+    typedef struct Solver {
+        Table        *table;
+        size_t        node_limit;
+        _Atomic bool *cancel;
+        size_t        nodes;
+        Move         *solution;
+        size_t        solution_length;
+        size_t        solution_capacity;
+    } Solver;
+
+    uint64_t    PositionKey(const Game *game);
+    uint64_t    ExactPositionKey(const Game *game);
+    SolveResult Solve(Solver *solver, const Game *game);
+    void        SolverFree(Solver *solver);
+#endif // STB_SOLVER_H
+
+#if defined(STB_SOLVER_IMPLEMENTATION) && !defined(STB_SOLVER_IMPLEMENTED)
+#define STB_SOLVER_IMPLEMENTED
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+
+    static inline uint64_t SolverMix(uint64_t value)
+    {
+        value += 0x9e3779b97f4a7c15ull;
+        value  = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value  = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    /* Columns and cells are summed so that positions differing only in their order share a key. */
+    uint64_t PositionKey(const Game *game)
+    {
+        uint64_t key = 0;
+        for (int i=0; i<game->pile_count; ++i) {
+            PileRole role = game->infos[i].role;
+            size_t   size = PileSize(game, i);
+            if (role == ROLE_FOUNDATION) {
+                key += SolverMix((uint64_t) i << 32 | size);
+                continue;
+            }
+            if (role == ROLE_POLL || role == ROLE_DECK) {
+                continue;
+            }
+            uint64_t pile = role;
+            for (size_t j=0; j<size; ++j) {
+                Card card = PILE_CARDS(game, i)[j];
+                pile = SolverMix(pile ^ ((uint64_t) card.number << 1 | card.hidden));
+            }
+            key += SolverMix(pile);
+        }
+        uint64_t stock = game->stock.split;
+        for (size_t i=0; i<game->stock.size; ++i) {
+            stock = SolverMix(stock ^ STOCK_CARDS(game)[i].number);
+        }
+        return (key ^ SolverMix(stock)) | 1;
+    }
+
+    /* Unlike PositionKey this tells apart positions that only differ in the order of their piles, for callers
+     * that name piles in the moves they keep. */
+    uint64_t ExactPositionKey(const Game *game)
+    {
+        uint64_t key = SolverMix(game->stock.split << 16 | game->stock.size);
+        for (int i=0; i<game->pile_count; ++i) {
+            size_t size = PileSize(game, i);
+            key = SolverMix(key ^ ((uint64_t) i << 32 | size));
+            for (size_t j=0; j<size; ++j) {
+                Card card = PileCard(game, i, j);
+                key = SolverMix(key ^ ((uint64_t) card.number << 1 | card.hidden));
+            }
+        }
+        return key | 1;
+    }
+
+    void TableBeginSearch(Table *table)
+    {
+        if (table->epoch == TABLE_MAX_EPOCH) {
+            memset(table->hot, 0, table->hot_count * sizeof(TableBucket));
+            if (table->disk != NULL) {
+                memset(table->disk, 0, table->disk_count * sizeof(TableBucket));
+            }
+            memset(table->proven, 0, sizeof(table->proven));
+            table->epoch = 0;
+        }
+        table->epoch++;
+    }
+
+    /* Every position a search visits is reachable from its root, so if the root was proven lost all of them are
+     * lost as well and stay valid for later searches. Otherwise the entries are dropped by moving to a new epoch. */
+    void TableEndSearch(Table *table, bool proven_lost)
+    {
+        if (proven_lost) {
+            table->proven[table->epoch / 8] |= 1 << (table->epoch % 8);
+        }
+    }
+
+    static inline bool TableLive(const Table *table, uint16_t epoch)
+    {
+        return epoch == table->epoch || (epoch != 0 && (table->proven[epoch / 8] & (1 << (epoch % 8))));
+    }
+
+    static inline TableBucket *TableHotBucket(const Table *table, uint64_t key)
+    {
+        return &table->hot[key % table->hot_count];
+    }
+
+    static inline TableBucket *TableDiskBucket(const Table *table, uint64_t key)
+    {
+        return &table->disk[(key >> 32 ^ key << 7) % table->disk_count];
+    }
+
+    static bool TableFind(const Table *table, const TableBucket *bucket, uint64_t key)
+    {
+        for (int i=0; i<TABLE_BUCKET_ENTRIES; ++i) {
+            if (bucket->keys[i] == key && TableLive(table, bucket->epochs[i])) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* Stores the key in a free slot, or in the next victim slot whose previous entry is returned through
+     * `evicted` so the caller can move it down a tier. */
+    static bool TablePut(const Table *table, TableBucket *bucket, uint64_t key, uint16_t epoch, uint64_t *evicted, uint16_t *evicted_epoch)
+    {
+        for (int i=0; i<TABLE_BUCKET_ENTRIES; ++i) {
+            if (!TableLive(table, bucket->epochs[i]) || bucket->keys[i] == key) {
+                bucket->keys[i]   = key;
+                bucket->epochs[i] = epoch;
+                return false;
+            }
+        }
+        int victim       = bucket->victim;
+        bucket->victim   = (victim + 1) % TABLE_BUCKET_ENTRIES;
+        *evicted         = bucket->keys[victim];
+        *evicted_epoch   = bucket->epochs[victim];
+        bucket->keys[victim]   = key;
+        bucket->epochs[victim] = epoch;
+        return true;
+    }
+
+    static void TableStore(Table *table, uint64_t key, uint16_t epoch)
+    {
+        uint64_t evicted;
+        uint16_t evicted_epoch;
+        if (!TablePut(table, TableHotBucket(table, key), key, epoch, &evicted, &evicted_epoch)) {
+            return;
+        }
+        if (table->disk == NULL) {
+            table->drops++;
+            return;
+        }
+        table->spills++;
+        uint64_t dropped;
+        uint16_t dropped_epoch;
+        if (TablePut(table, TableDiskBucket(table, evicted), evicted, evicted_epoch, &dropped, &dropped_epoch)) {
+            table->drops++;
+        }
+    }
+
+    bool TableSeen(Table *table, uint64_t key)
+    {
+        if (TableFind(table, TableHotBucket(table, key), key)) {
+            table->hot_hits++;
+            return true;
+        }
+        if (table->disk != NULL) {
+            TableBucket *bucket = TableDiskBucket(table, key);
+            for (int i=0; i<TABLE_BUCKET_ENTRIES; ++i) {
+                if (bucket->keys[i] == key && TableLive(table, bucket->epochs[i])) {
+                    table->disk_hits++;
+                    TableStore(table, key, bucket->epochs[i]);
+                    return true;
+                }
+            }
+        }
+        table->misses++;
+        return false;
+    }
+
+    void TableInsert(Table *table, uint64_t key)
+    {
+        TableStore(table, key, table->epoch);
+    }
+
+    void SolverFree(Solver *solver)
+    {
+        free(solver->solution);
+        solver->solution          = NULL;
+        solver->solution_length   = 0;
+        solver->solution_capacity = 0;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    Table *TableOpen(size_t memory_bytes, const char *disk_path, size_t disk_bytes)
+    {
+        if (disk_path != NULL) {
+            fprintf(stderr, "%s:%d: Disk tables are not supported on this platform\n", __FILE__, __LINE__);
+            return NULL;
+        }
+        Table *table = calloc(1, sizeof(Table));
+        if (table == NULL) {
+            return NULL;
+        }
+        table->hot_count = memory_bytes / sizeof(TableBucket) > 0 ? memory_bytes / sizeof(TableBucket) : 1;
+        table->hot       = calloc(table->hot_count, sizeof(TableBucket));
+        if (table->hot == NULL) {
+            free(table);
+            return NULL;
+        }
+        return table;
+    }
+    void TableClose(Table *table)
+    {
+        if (table != NULL) {
+            free(table->hot);
+            free(table);
+        }
+    }
+    void TablePrefetch(Table *table, const uint64_t keys[], size_t count) {}
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+
+    /* `memory_bytes` bounds the hot cache. With a `disk_path` the evicted entries go to a sparse file of
+     * `disk_bytes`, whose pages the kernel keeps cached or writes back as memory allows. */
+    Table *TableOpen(size_t memory_bytes, const char *disk_path, size_t disk_bytes)
+    {
+        Table *table = calloc(1, sizeof(Table));
+        if (table == NULL) {
+            return NULL;
+        }
+        table->hot_count = memory_bytes / sizeof(TableBucket) > 0 ? memory_bytes / sizeof(TableBucket) : 1;
+        table->hot       = calloc(table->hot_count, sizeof(TableBucket));
+        if (table->hot == NULL) {
+            fprintf(stderr, "%s:%d: Couldn't allocate %zu bytes of table memory\n", __FILE__, __LINE__, memory_bytes);
+            free(table);
+            return NULL;
+        }
+        if (disk_path == NULL || disk_bytes < sizeof(TableBucket)) {
+            return table;
+        }
+        table->disk_count = disk_bytes / sizeof(TableBucket);
+        table->disk_bytes = table->disk_count * sizeof(TableBucket);
+        int fd = open(disk_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, table->disk_bytes) != 0) {
+            fprintf(stderr, "%s:%d: Couldn't create table file %s\n", __FILE__, __LINE__, disk_path);
+            if (fd >= 0) {
+                close(fd);
+            }
+            TableClose(table);
+            return NULL;
+        }
+        table->disk = mmap(NULL, table->disk_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (table->disk == MAP_FAILED) {
+            fprintf(stderr, "%s:%d: Couldn't map table file %s\n", __FILE__, __LINE__, disk_path);
+            table->disk = NULL;
+            TableClose(table);
+            return NULL;
+        }
+        madvise(table->disk, table->disk_bytes, MADV_RANDOM);
+        return table;
+    }
+
+    void TableClose(Table *table)
+    {
+        if (table == NULL) {
+            return;
+        }
+        if (table->disk != NULL) {
+            munmap(table->disk, table->disk_bytes);
+        }
+        free(table->hot);
+        free(table);
+    }
+
+    /* Called with all children of a node before any of them is looked up. Disk buckets the hot cache cannot
+     * answer are requested from the kernel in one go, so their pages are read in parallel instead of one fault
+     * at a time. */
+    void TablePrefetch(Table *table, const uint64_t keys[], size_t count)
+    {
+        if (table->disk == NULL) {
+            return;
+        }
+        long page = sysconf(_SC_PAGESIZE);
+        for (size_t i=0; i<count; ++i) {
+            if (TableFind(table, TableHotBucket(table, keys[i]), keys[i])) {
+                continue;
+            }
+            uintptr_t address = (uintptr_t) TableDiskBucket(table, keys[i]);
+            madvise((void*) (address - address % page), page, MADV_WILLNEED);
+            table->prefetches++;
+        }
+    }
+#endif
+
+    typedef struct SolverFrame {
+        Game     game;
+        Move     moves[MAX_MOVES];
+        uint64_t keys[MAX_MOVES];
+        size_t   count;
+        size_t   next;
+        Move     via[SOLVER_MAX_VIA];
+        size_t   via_count;
+    } SolverFrame;
+
+    /* Higher scores are tried first. Negative scores are never tried. */
+    static int MoveScore(const Game *game, Move move)
+    {
+        if (move.kind == MOVE_DRAW) {
+            return 10;
+        }
+        PileRole source = game->infos[move.source].role;
+        PileRole target = game->infos[move.target].role;
+        if (source == ROLE_FOUNDATION) {
+            return 0;
+        }
+        if (target == ROLE_FOUNDATION) {
+            return 100;
+        }
+        if (source == ROLE_COLUMN && target == ROLE_COLUMN && move.depth == 0 && game->piles[move.target].size == 0) {
+            return -1;
+        }
+        if (source == ROLE_COLUMN && move.depth > 0 && PILE_CARDS(game, move.source)[move.depth - 1].hidden) {
+            return 80;
+        }
+        if (source == ROLE_POLL) {
+            return 60;
+        }
+        if (source == ROLE_CELL) {
+            return 55;
+        }
+        if (source == ROLE_COLUMN && move.depth == 0) {
+            return 50;
+        }
+        return target == ROLE_CELL ? 20 : 30;
+    }
+
+    /* Applies the move followed by every safe move it uncovers, recording them all in `via`. */
+    static void SolverAdvance(Game *game, Move move, Move via[], size_t *via_count)
+    {
+        *via_count = 0;
+        game->variant->apply_move(game, move);
+        via[(*via_count)++] = move;
+        Move safe;
+        while (*via_count < SOLVER_MAX_VIA && game->variant->find_safe_move(game, &safe)) {
+            game->variant->apply_move(game, safe);
+            via[(*via_count)++] = safe;
+        }
+    }
+
+    /* Generates the moves of a position once, for its dead-pattern check and its children. The costly search
+     * for a position with no moves runs only when nothing but a draw was generated. Returns false, with no
+     * children, if the position is dead. */
+    static bool SolverExpand(Solver *solver, SolverFrame *frame)
+    {
+        const Variant *variant    = frame->game.variant;
+        Move           moves[MAX_MOVES];
+        int            scores[MAX_MOVES];
+        size_t         count      = variant->generate_moves(&frame->game, moves);
+        bool           draws_only = true;
+        frame->count = 0;
+        frame->next  = 0;
+        for (size_t i=0; i<count; ++i) {
+            draws_only &= moves[i].kind == MOVE_DRAW;
+        }
+        if (variant->find_dead_cycle(&frame->game, NULL) != DEAD_NONE ||
+            (draws_only && variant->find_dead_pattern(&frame->game, NULL) != DEAD_NONE)
+        ) {
+            return false;
+        }
+        for (size_t i=0; i<count; ++i) {
+            int score = MoveScore(&frame->game, moves[i]);
+            if (score < 0) {
+                continue;
+            }
+            size_t j = frame->count++;
+            for (; j>0 && scores[j-1] < score; --j) {
+                frame->moves[j] = frame->moves[j-1];
+                scores[j]       = scores[j-1];
+            }
+            frame->moves[j] = moves[i];
+            scores[j]       = score;
+        }
+        for (size_t i=0; i<frame->count; ++i) {
+            Game   child = frame->game;
+            Move   via[SOLVER_MAX_VIA];
+            size_t via_count;
+            SolverAdvance(&child, frame->moves[i], via, &via_count);
+            frame->keys[i] = PositionKey(&child);
+        }
+        TablePrefetch(solver->table, frame->keys, frame->count);
+        return true;
+    }
+
+    static void SolverRecord(Solver *solver, const SolverFrame *frames, size_t depth)
+    {
+        solver->solution_length = 0;
+        for (size_t i=0; i<=depth; ++i) {
+            if (frames[i].via_count == 0) {
+                continue;
+            }
+            if (solver->solution_length + frames[i].via_count > solver->solution_capacity) {
+                solver->solution_capacity = 2 * (solver->solution_length + frames[i].via_count);
+                solver->solution = realloc(solver->solution, solver->solution_capacity * sizeof(Move));
+            }
+            memcpy(solver->solution + solver->solution_length, frames[i].via, frames[i].via_count * sizeof(Move));
+            solver->solution_length += frames[i].via_count;
+        }
+    }
+
+    /* Depth first search over positions, skipping every position the table has seen. Positions proven dead by
+     * the variant's dead-pattern detector are not expanded. Gives up after `node_limit` nodes if it is not 0. */
+    SolveResult Solve(Solver *solver, const Game *game)
+    {
+        size_t       capacity = 64;
+        SolverFrame *frames   = malloc(capacity * sizeof(SolverFrame));
+        if (frames == NULL) {
+            return SOLVE_UNKNOWN;
+        }
+        solver->nodes = 0;
+        TableBeginSearch(solver->table);
+
+        frames[0].game      = *game;
+        frames[0].via_count = 0;
+        Move safe;
+        while (frames[0].via_count < SOLVER_MAX_VIA && game->variant->find_safe_move(&frames[0].game, &safe)) {
+            game->variant->apply_move(&frames[0].game, safe);
+            frames[0].via[frames[0].via_count++] = safe;
+        }
+        uint64_t    root   = PositionKey(&frames[0].game);
+        SolveResult result = SOLVE_LOST;
+        size_t      depth  = 0;
+        if (IsGameFinished(&frames[0].game)) {
+            SolverRecord(solver, frames, 0);
+            result = SOLVE_WON;
+            goto done;
+        }
+        if (TableSeen(solver->table, root)) {  /* Reached by an earlier search that proved it lost */
+            goto done;
+        }
+        TableInsert(solver->table, root);
+        SolverExpand(solver, &frames[0]);
+        for (;;) {
+            SolverFrame *frame = &frames[depth];
+            if (frame->next == frame->count) {
+                if (depth == 0) {
+                    break;
+                }
+                depth--;
+                continue;
+            }
+            size_t next = frame->next++;
+            if (TableSeen(solver->table, frame->keys[next])) {
+                continue;
+            }
+            TableInsert(solver->table, frame->keys[next]);
+            solver->nodes++;
+            if ((solver->node_limit > 0 && solver->nodes > solver->node_limit) ||
+                (solver->cancel != NULL && solver->nodes % 256 == 0 && atomic_load_explicit(solver->cancel, memory_order_relaxed))
+            ) {
+                result = SOLVE_UNKNOWN;
+                break;
+            }
+            if (depth + 1 == capacity) {
+                SolverFrame *grown = realloc(frames, 2 * capacity * sizeof(SolverFrame));
+                if (grown == NULL) {
+                    result = SOLVE_UNKNOWN;
+                    break;
+                }
+                frames   = grown;
+                capacity = 2 * capacity;
+                frame    = &frames[depth];
+            }
+            SolverFrame *child = &frames[depth + 1];
+            child->game = frame->game;
+            SolverAdvance(&child->game, frame->moves[next], child->via, &child->via_count);
+            if (IsGameFinished(&child->game)) {
+                SolverRecord(solver, frames, depth + 1);
+                result = SOLVE_WON;
+                break;
+            }
+            if (SolverExpand(solver, child)) {
+                depth++;
+            }
+        }
+    done:
+        TableEndSearch(solver->table, result == SOLVE_LOST);
+        free(frames);
+        return result;
+    }
+#endif // STB_SOLVER_IMPLEMENTATION